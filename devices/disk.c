@@ -6,6 +6,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/softirq.h"
 #include "threads/synch.h"
 
 /* The code in this file is an interface to an ATA (IDE)
@@ -71,7 +72,8 @@ struct channel {
 	struct lock lock;           /* Must acquire to access the controller. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
-	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+	struct semaphore completion_wait;   /* Up'd by disk_softirq(). */
+	unsigned completions;       /* Interrupts not yet passed to the waiter. */
 
 	struct disk devices[2];     /* The devices on this channel. */
 };
@@ -95,12 +97,15 @@ static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static softirq_func disk_softirq;
 
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
 	size_t chan_no;
 
+	softirq_register (SOFTIRQ_DISK, disk_softirq);
+
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
 		struct channel *c = &channels[chan_no];
 		int dev_no;
@@ -122,6 +127,7 @@ disk_init (void) {
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		c->completions = 0;
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -511,7 +517,8 @@ select_device_wait (const struct disk *d) {
 	wait_until_idle (d);
 }
 
-/* ATA interrupt handler. */
+/* ATA interrupt handler.  Only acknowledges the interrupt, and
+   leaves waking up the waiter to disk_softirq(). */
 static void
 interrupt_handler (struct intr_frame *f) {
 	struct channel *c;
@@ -520,7 +527,8 @@ interrupt_handler (struct intr_frame *f) {
 		if (f->vec_no == c->irq) {
 			if (c->expecting_interrupt) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
-				sema_up (&c->completion_wait);      /* Wake up waiter. */
+				c->completions++;
+				softirq_raise (SOFTIRQ_DISK);
 			} else
 				printf ("%s: unexpected interrupt\n", c->name);
 			return;
@@ -529,6 +537,23 @@ interrupt_handler (struct intr_frame *f) {
 	NOT_REACHED ();
 }
 
+/* Disk softirq: wakes up the threads waiting for the commands
+   that completed. */
+static void
+disk_softirq (void) {
+	struct channel *c;
+
+	for (c = channels; c < channels + CHANNEL_CNT; c++) {
+		enum intr_level old_level = intr_disable ();
+		unsigned completions = c->completions;
+
+		c->completions = 0;
+		intr_set_level (old_level);
+		while (completions-- > 0)
+			sema_up (&c->completion_wait);      /* Wake up waiter. */
+	}
+}
+
 static void
 inspect_read_cnt (struct intr_frame *f) {
 	struct disk * d = disk_get (f->R.rdx, f->R.rcx);
@@ -5,6 +5,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/softirq.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -58,6 +59,7 @@ static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
+static softirq_func serial_softirq;
 
 /* Initializes the serial port device for polling mode.
    Polling mode busy-waits for the serial port to become free
@@ -85,6 +87,7 @@ serial_init_queue (void) {
 		init_poll ();
 	ASSERT (mode == POLL);
 
+	softirq_register (SOFTIRQ_SERIAL, serial_softirq);
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
 	mode = QUEUE;
 	old_level = intr_disable ();
@@ -106,8 +109,10 @@ serial_putc (uint8_t byte) {
 	} else {
 		/* Otherwise, queue a byte and update the interrupt enable
 		   register. */
-		if (old_level == INTR_OFF && intq_full (&txq)) {
-			/* Interrupts are off and the transmit queue is full.
+		if ((old_level == INTR_OFF || intr_context ())
+				&& intq_full (&txq)) {
+			/* Interrupts are off, or we are in a softirq that
+			   cannot sleep, and the transmit queue is full.
 			   If we wanted to wait for the queue to empty,
 			   we'd have to reenable interrupts.
 			   That's impolite, so we'll send a character via
@@ -193,23 +198,48 @@ putc_poll (uint8_t byte) {
 	outb (THR_REG, byte);
 }
 
-/* Serial interrupt handler. */
+/* Serial interrupt handler.  Leaves the transfers to
+   serial_softirq(). */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) {
 	/* Inquire about interrupt in UART.  Without this, we can
 	   occasionally miss an interrupt running under QEMU. */
 	inb (IIR_REG);
 
+	/* Keep the UART quiet until the softirq has serviced it. */
+	outb (IER_REG, 0);
+	softirq_raise (SOFTIRQ_SERIAL);
+}
+
+/* Serial softirq: moves bytes between the UART and the queues.
+   Interrupts are turned off for one byte at a time, so that
+   other interrupts are not held off for a whole burst. */
+static void
+serial_softirq (void) {
+	enum intr_level old_level;
+
 	/* As long as we have room to receive a byte, and the hardware
 	   has a byte for us, receive a byte.  */
-	while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
+	for (;;) {
+		old_level = intr_disable ();
+		if (input_full () || (inb (LSR_REG) & LSR_DR) == 0)
+			break;
 		input_putc (inb (RBR_REG));
+		intr_set_level (old_level);
+	}
+	intr_set_level (old_level);
 
 	/* As long as we have a byte to transmit, and the hardware is
 	   ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
+	for (;;) {
+		old_level = intr_disable ();
+		if (intq_empty (&txq) || (inb (LSR_REG) & LSR_THRE) == 0)
+			break;
 		outb (THR_REG, intq_getc (&txq));
+		intr_set_level (old_level);
+	}
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
+	intr_set_level (old_level);
 }
@@ -3,13 +3,38 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "threads/apic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/profile.h"
+#include "threads/smp.h"
+#include "threads/softirq.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "fixed.h"
-
-/* See [8254] for hardware details of the 8254 timer chip. */
+#include "intrinsic.h"
+
+/* See [8254] for hardware details of the 8254 timer chip.
+
+   When external interrupts go through the APICs, the tick comes
+   from the calling CPU's local APIC timer instead, whose rate
+   is measured against the 8254 once at boot.  The 8254 is then
+   left idle.
+
+   Either way, the tick source (the "clock") normally runs in
+   periodic mode.  It switches to one-shot mode whenever it has
+   to interrupt at some other moment: for a high-resolution
+   timer that expires before the next tick, or to skip ticks
+   while idle in tickless mode.  Time itself is read from the
+   CPU's time-stamp counter (TSC), also measured against the
+   8254 at boot, so one-shot mode never loses track of ticks.
+
+   Only the bootstrap processor (BSP) keeps time and runs timers.
+   Each application processor has its local APIC timer tick in
+   periodic mode, only to drive the scheduling of its own
+   threads.  With more than one CPU online, the BSP's tick never
+   stops while idle either, since timers armed by other CPUs
+   would not move its deadline. */
 
 #if TIMER_FREQ < 19
 #error 8254 timer requires TIMER_FREQ >= 19
@@ -25,25 +50,154 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* If false (default), the timer interrupts on every tick.
+   If true, the idle thread stops the periodic tick and programs
+   the timer to fire once at the next timer wheel deadline.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* 8254 input frequency and the largest count it can be loaded
+   with.  PIT_TICK_COUNT is the count for a single timer tick. */
+#define PIT_HZ 1193180
+#define PIT_MAX_COUNT 0xffff
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Local APIC timer divide configuration: count once every 16
+   bus clocks. */
+#define LAPIC_TIMER_DIV16 0x3
+
+/* Local APIC timer count for a single timer tick, or 0 if the
+   8254 drives the tick. */
+static uint32_t lapic_tick_count;
+
+#define NSEC_PER_SEC 1000000000LL
+#define TICK_NS (NSEC_PER_SEC / TIMER_FREQ)
+
+/* A one-shot that fires this close before an event is taken to
+   be on time.  The clock and the TSC are calibrated separately,
+   so the clock may run slightly fast by the TSC's measure. */
+#define CLOCK_SLACK_NS 1000
+
+/* Shortest one-shot the clock is programmed for. */
+#define CLOCK_MIN_NS 1000
+
+/* Longest stretch, in ticks, that a single one-shot can cover. */
+static int64_t oneshot_max_ticks;
+
+/* Is the clock in one-shot mode?  If so, it is programmed to
+   interrupt at clock_deadline. */
+static bool clock_oneshot;
+static int64_t clock_deadline;
+
+/* timer_ns() time at which the next tick is due. */
+static int64_t next_tick_ns;
+
+/* TSC clocksource: TSC increments per second, the TSC value at
+   boot, and the multiplier that converts TSC cycles into
+   nanoseconds as (cycles * tsc_ns_mult) >> 32. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static uint64_t tsc_ns_mult;
+
+/* Armed high-resolution timers, in order of expiry. */
+static struct list hrtimer_list;
+
+/* Sleeps shorter than this spin on the TSC, since blocking and
+   being woken by an interrupt takes about as long. */
+#define HRTIMER_MIN_SLEEP_NS 10000
+
+/* Kernel timers are kept in a hierarchical timing wheel.  Level 0
+   has one slot per tick for the next WHEEL0_SIZE ticks.  Each
+   higher level has WHEELN_SIZE slots, and one of its slots spans
+   a whole revolution of the level below.  Whenever a level wraps
+   around, the next slot of the level above is "cascaded", that
+   is, its timers are redistributed into the lower levels.  Thus
+   arming and canceling a timer are O(1), and each tick only
+   touches the timers that are about to expire. */
+#define WHEEL0_BITS 8
+#define WHEELN_BITS 6
+#define WHEEL0_SIZE (1 << WHEEL0_BITS)
+#define WHEELN_SIZE (1 << WHEELN_BITS)
+#define WHEEL0_MASK (WHEEL0_SIZE - 1)
+#define WHEELN_MASK (WHEELN_SIZE - 1)
+#define WHEEL_LEVELS 5
+#define WHEEL_SPAN (1LL << (WHEEL0_BITS + (WHEEL_LEVELS - 1) * WHEELN_BITS))
+
+static struct list wheel0[WHEEL0_SIZE];
+static struct list wheeln[WHEEL_LEVELS - 1][WHEELN_SIZE];
+
+/* Next tick whose level-0 slot has not been run yet. */
+static int64_t wheel_base;
+
+/* Set by the tick that ends an MLFQS second, for the scheduler
+   softirq to pick up. */
+static bool mlfqs_second_due;
+
 static intr_handler_func timer_interrupt;
+static intr_handler_func clock_interrupt;
+static void timer_do_tick (void);
+static void timer_cpu_tick (void);
+static softirq_func timer_softirq;
+static softirq_func sched_softirq;
+static bool clock_catch_up (int64_t now);
+static void clock_reprogram (bool ticked);
+static void clock_set_periodic (void);
+static void clock_set_oneshot (int64_t deadline);
+static void tsc_calibrate (void);
+static uint32_t lapic_timer_calibrate (void);
+static void hrtimer_run (int64_t now);
+static void hrtimer_wakeup (void *t_);
+static void pit_set_periodic (void);
+static void pit_set_oneshot (uint16_t count);
+static bool pit_expired (void);
+static int64_t wheel_next_event (int64_t limit);
+static void wheel_init (void);
+static void wheel_add (struct timer *);
+static void wheel_run (int64_t now);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
-static void real_time_sleep (int64_t num, int32_t denom);
 
-/* Sets up the 8254 Programmable Interval Timer (PIT) to
-   interrupt PIT_FREQ times per second, and registers the
-   corresponding interrupt. */
+/* Sets up the local APIC timer, or the 8254 Programmable
+   Interval Timer (PIT) without APICs, to interrupt TIMER_FREQ
+   times per second, and registers the corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	tsc_calibrate ();
+	if (intr_apic_enabled ()) {
+		lapic_tick_count = lapic_timer_calibrate ();
+		ASSERT (lapic_tick_count > 0);
+
+		/* Keep one-shot counts in range, and the conversion from
+		   nanoseconds to counts in clock_set_oneshot() in 64 bits. */
+		oneshot_max_ticks = UINT32_MAX / lapic_tick_count;
+		if (oneshot_max_ticks > TIMER_FREQ)
+			oneshot_max_ticks = TIMER_FREQ;
+	} else
+		oneshot_max_ticks = PIT_MAX_COUNT / PIT_TICK_COUNT;
+	clock_set_periodic ();
+
+	list_init (&hrtimer_list);
+	wheel_init ();
+	softirq_register (SOFTIRQ_TIMER, timer_softirq);
+	softirq_register (SOFTIRQ_SCHED, sched_softirq);
+	intr_register_ext (0x20, timer_interrupt,
+			lapic_tick_count ? "LAPIC Timer" : "8254 Timer"); // 0x20 벡터에 timer_interrupt 함수를 등록한다. 타이머 인터럽트가 발생하면 timer_interrupt가 호출된다.
+	if (lapic_tick_count != 0)
+		intr_register_int (LAPIC_CLOCK_VEC, 0, INTR_OFF, clock_interrupt,
+				"Clock IPI");
+}
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+/* Starts the local APIC timer of the running application
+   processor, interrupting TIMER_FREQ times per second like the
+   BSP's.  Interrupts must be off. */
+void
+timer_init_ap (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (lapic_tick_count != 0);
 
-	intr_register_ext (0x20, timer_interrupt, "8254 Timer"); // 0x20 벡터에 timer_interrupt 함수를 등록한다. 타이머 인터럽트가 발생하면 timer_interrupt가 호출된다.
+	lapic_write (LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+	lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_PERIODIC | 0x20);
+	lapic_write (LAPIC_TIMER_ICR, lapic_tick_count);
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -88,37 +242,92 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since timer_init(), as
+   measured by the TSC. */
+int64_t
+timer_ns (void) {
+	uint64_t cycles = rdtsc () - tsc_base;
+	return ((unsigned __int128) cycles * tsc_ns_mult) >> 32;
+}
+
+/* Returns the raw value of the CPU's time-stamp counter. */
+uint64_t
+timer_cycles (void) {
+	return rdtsc ();
+}
+
+/* Returns the TSC frequency, in cycles per second. */
+uint64_t
+timer_cycles_per_sec (void) {
+	return tsc_hz;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {
 	int64_t start = timer_ticks ();
 	ASSERT (intr_get_level () == INTR_ON);
+	if (ticks <= 0)
+		return;
+
+	timer_sleep_until (start + ticks);
+}
+
+/* Suspends execution until timer tick TICK.  Returns at once if
+   TICK has already passed.  Unlike calling timer_sleep() with a
+   relative count in a loop, this does not accumulate the time
+   spent running between sleeps. */
+void
+timer_sleep_until (int64_t tick) {
+	ASSERT (intr_get_level () == INTR_ON);
 
 	enum intr_level old_level = intr_disable ();
 
-	// make thread sleep for 'ticks' ticks using global ticks(=start)
-	thread_sleep (start + ticks);		
-	
+	// make thread sleep until global ticks reaches 'tick'
+	if (tick > ticks)
+		thread_sleep (tick);
+
 	intr_set_level (old_level);
+}
+
+/* Suspends execution until timer_ns() reaches DEADLINE.  The
+   thread blocks and is woken by a high-resolution timer.  Very
+   short waits, and waits with interrupts off, spin on the TSC
+   instead. */
+void
+timer_nsleep_until (int64_t deadline) {
+	struct hrtimer t;
+
+	if (intr_get_level () == INTR_OFF
+			|| deadline - timer_ns () < HRTIMER_MIN_SLEEP_NS) {
+		while (timer_ns () < deadline)
+			asm volatile ("pause");
+		return;
+	}
 
+	hrtimer_setup (&t, hrtimer_wakeup, thread_current ());
+	enum intr_level old_level = intr_disable ();
+	hrtimer_arm (&t, deadline);
+	thread_block ();
+	intr_set_level (old_level);
 }
 
 /* Suspends execution for approximately MS milliseconds. */
 void
 timer_msleep (int64_t ms) {
-	real_time_sleep (ms, 1000);
+	timer_nsleep_until (timer_ns () + ms * 1000 * 1000);
 }
 
 /* Suspends execution for approximately US microseconds. */
 void
 timer_usleep (int64_t us) {
-	real_time_sleep (us, 1000 * 1000);
+	timer_nsleep_until (timer_ns () + us * 1000);
 }
 
 /* Suspends execution for approximately NS nanoseconds. */
 void
 timer_nsleep (int64_t ns) {
-	real_time_sleep (ns, 1000 * 1000 * 1000);
+	timer_nsleep_until (timer_ns () + ns);
 }
 
 /* Prints timer statistics. */
@@ -127,27 +336,538 @@ timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Initializes T to call FUNC (AUX) when it expires.  T is not
+   armed until timer_arm() is called. */
+void
+timer_setup (struct timer *t, timer_func *func, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (func != NULL);
+
+	t->expires = 0;
+	t->func = func;
+	t->aux = aux;
+	t->armed = false;
+}
+
+/* Arms T to fire at absolute tick EXPIRES, replacing any earlier
+   expiry.  If EXPIRES has already passed, T fires on the next
+   tick.  May be called from an interrupt handler. */
+void
+timer_arm (struct timer *t, int64_t expires) {
+	enum intr_level old_level = intr_disable ();
+
+	if (t->armed)
+		list_remove (&t->elem);
+	t->expires = expires;
+	t->armed = true;
+	wheel_add (t);
+
+	intr_set_level (old_level);
+}
+
+/* Disarms T.  Returns true if T was armed, false if it had
+   already fired or was never armed. */
+bool
+timer_cancel (struct timer *t) {
+	enum intr_level old_level = intr_disable ();
+	bool was_armed = t->armed;
+
+	if (was_armed) {
+		list_remove (&t->elem);
+		t->armed = false;
+	}
+
+	intr_set_level (old_level);
+	return was_armed;
+}
+
+/* Returns true if T is armed and has not fired yet. */
+bool
+timer_pending (const struct timer *t) {
+	return t->armed;
+}
+
+/* Initializes high-resolution timer T to call FUNC (AUX) when it
+   expires.  T is not armed until hrtimer_arm() is called. */
+void
+hrtimer_setup (struct hrtimer *t, timer_func *func, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (func != NULL);
+
+	t->expires = 0;
+	t->func = func;
+	t->aux = aux;
+	t->armed = false;
+}
+
+/* Returns true if hrtimer A expires before hrtimer B. */
+static bool
+hrtimer_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct hrtimer *a = list_entry (a_, struct hrtimer, elem);
+	const struct hrtimer *b = list_entry (b_, struct hrtimer, elem);
+
+	return a->expires < b->expires;
+}
+
+/* Arms T to fire at timer_ns() time EXPIRES, replacing any
+   earlier expiry.  If EXPIRES has already passed, T fires
+   almost at once.  May be called from an interrupt handler. */
+void
+hrtimer_arm (struct hrtimer *t, int64_t expires) {
+	enum intr_level old_level = intr_disable ();
+
+	if (t->armed)
+		list_remove (&t->elem);
+	t->expires = expires;
+	t->armed = true;
+	list_insert_ordered (&hrtimer_list, &t->elem, hrtimer_less, NULL);
+
+	/* Bring the interrupt forward if T is now the first event.
+	   The clock is the BSP's, so another CPU asks it to. */
+	if (list_front (&hrtimer_list) == &t->elem
+			&& (!clock_oneshot || expires < clock_deadline)) {
+		if (cpu_is_bsp ())
+			clock_reprogram (false);
+		else
+			lapic_send_ipi (cpus[0].lapic_id, LAPIC_CLOCK_VEC);
+	}
+
+	intr_set_level (old_level);
+}
+
+/* Disarms T.  Returns true if T was armed, false if it had
+   already fired or was never armed.  The clock is left as
+   programmed; an interrupt for T finds nothing to do. */
+bool
+hrtimer_cancel (struct hrtimer *t) {
+	enum intr_level old_level = intr_disable ();
+	bool was_armed = t->armed;
+
+	if (was_armed) {
+		list_remove (&t->elem);
+		t->armed = false;
+	}
+
+	intr_set_level (old_level);
+	return was_armed;
+}
+
+/* Returns true if T is armed and has not fired yet. */
+bool
+hrtimer_pending (const struct hrtimer *t) {
+	return t->armed;
+}
+
+/* Fires the high-resolution timers that expire by NOW. */
+static void
+hrtimer_run (int64_t now) {
+	while (!list_empty (&hrtimer_list)) {
+		struct hrtimer *t = list_entry (list_front (&hrtimer_list),
+				struct hrtimer, elem);
+		if (t->expires > now + CLOCK_SLACK_NS)
+			break;
+
+		list_pop_front (&hrtimer_list);
+		t->armed = false;
+		t->func (t->aux);
+	}
+}
+
+/* hrtimer callback for timer_nsleep_until(). */
+static void
+hrtimer_wakeup (void *t_) {
+	struct thread *t = t_;
+
+	thread_unblock (t);
+	thread_try_preemption ();
+}
+
+/* Called by the idle thread, with interrupts off, right before
+   it halts.  In tickless mode, stops the periodic tick and arms
+   the timer to interrupt once at the next tick that has timer
+   work to do (at most oneshot_max_ticks away). */
+void
+timer_idle_enter (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || !cpu_is_bsp () || smp_online_cnt () > 1)
+		return;
+
+	int64_t delta = wheel_next_event (ticks + oneshot_max_ticks) - ticks;
+	if (delta > 1) {
+		int64_t deadline = next_tick_ns + (delta - 1) * TICK_NS;
+		if (!list_empty (&hrtimer_list)) {
+			struct hrtimer *t = list_entry (list_front (&hrtimer_list),
+					struct hrtimer, elem);
+			if (t->expires < deadline)
+				deadline = t->expires;
+		}
+		clock_set_oneshot (deadline);
+	}
+}
+
+/* Called by the idle thread, with interrupts off, after it wakes
+   up.  If the clock is in one-shot mode, catches up on the ticks
+   and high-resolution timers that are due and programs the
+   clock for the next tick. */
+void
+timer_idle_exit (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!clock_oneshot || !cpu_is_bsp ())
+		return;
+
+	int64_t now = timer_ns ();
+	clock_catch_up (now);
+	hrtimer_run (now);
+	clock_reprogram (false);
+}
+
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
+timer_interrupt (struct intr_frame *args) {
+	int64_t now = timer_ns ();
+	bool ticked;
+
+	if (!cpu_is_bsp ()) {
+		timer_cpu_tick ();
+		return;
+	}
+
+	if (profile_hz > 0)
+		profile_sample (args);
+
+	if (!clock_oneshot) {
+		/* In periodic mode every interrupt is one tick. */
+		next_tick_ns = now + TICK_NS;
+		timer_do_tick ();
+		ticked = true;
+	} else {
+		/* A one-shot may stand for no tick at all (if it was
+		   for an hrtimer) or for several (after tickless idle). */
+		ticked = clock_catch_up (now);
+	}
+	hrtimer_run (now);
+	clock_reprogram (ticked);
+}
+
+/* Clock IPI handler: an hrtimer armed on another CPU may be due
+   before the BSP's clock is set to interrupt. */
+static void
+clock_interrupt (struct intr_frame *args UNUSED) {
+	clock_reprogram (false);
+}
+
+/* Does the work of a single timer tick that must happen in the
+   interrupt itself.  The rest is raised as softirqs. */
+static void
+timer_do_tick (void) {
 	ticks++;
-	// When a timer interrupt occurs, wake up threads in sleep_list if their 'local ticks' is expired
-	thread_wakeup (ticks);
+	// Fire kernel timers (including sleeping threads' wakeups) that expired by now, out of the hard interrupt
+	softirq_raise (SOFTIRQ_TIMER);
 
 	// For mlfqs
 	if (thread_mlfqs) {
-		// Incrememnt recent_cpu of current thread per timer tick
+		// Recalculate load_avg, recent_cpu every 1 sec(= TIMER FREQ ticks), and priority every 4th tick,
+		// in the scheduler softirq
+		if (ticks % TIMER_FREQ == 0)
+			mlfqs_second_due = true;
+		if (ticks % 4 == 0 || mlfqs_second_due)
+			softirq_raise (SOFTIRQ_SCHED);
+	}
+	timer_cpu_tick ();
+}
+
+/* Does the work of a timer tick that concerns only the running
+   CPU.  The BSP does it as part of timer_do_tick(); every other
+   CPU, on each interrupt of its own local APIC timer. */
+static void
+timer_cpu_tick (void) {
+	// For mlfqs
+	// Incrememnt recent_cpu of current thread per timer tick
+	if (thread_mlfqs)
 		thread_current ()->fixed_recent_cpu += 1 * fx_scale;
-		// Recalculate load_avg, recent_cpu every 1 sec(= TIMER FREQ ticks)
-		if (ticks % TIMER_FREQ == 0) {
-			thread_recalc_load_avg ();
-			thread_recalc_recent_cpu_all ();
+	thread_tick ();
+}
+
+/* Timer softirq: fires the kernel timers that expired. */
+static void
+timer_softirq (void) {
+	wheel_run (timer_ticks ());
+}
+
+/* Scheduler softirq: MLFQS recalculation deferred from
+   timer_do_tick(). */
+static void
+sched_softirq (void) {
+	enum intr_level old_level = intr_disable ();
+
+	// Only runnable threads are decayed here; blocked ones catch up when they are woken
+	if (mlfqs_second_due) {
+		mlfqs_second_due = false;
+		thread_recalc_load_avg ();
+		thread_recalc_recent_cpu_runnable ();
+	}
+	// Only the running threads' recent_cpu have changed since, so they are the only ones to update
+	thread_recalc_priority_running ();
+
+	intr_set_level (old_level);
+}
+
+/* Does every tick that is due by NOW.  Returns true if there
+   was at least one. */
+static bool
+clock_catch_up (int64_t now) {
+	bool ticked = false;
+
+	while (next_tick_ns <= now + CLOCK_SLACK_NS) {
+		next_tick_ns += TICK_NS;
+		timer_do_tick ();
+		ticked = true;
+	}
+	return ticked;
+}
+
+/* Programs the clock for the earlier of the next tick and the
+   first hrtimer expiry.  Periodic mode is kept, or resumed right
+   after a tick (TICKED), whenever no hrtimer is due before the
+   next tick. */
+static void
+clock_reprogram (bool ticked) {
+	int64_t deadline = next_tick_ns;
+
+	if (!list_empty (&hrtimer_list)) {
+		struct hrtimer *t = list_entry (list_front (&hrtimer_list),
+				struct hrtimer, elem);
+		if (t->expires < deadline)
+			deadline = t->expires;
+	}
+
+	if (deadline < next_tick_ns || (clock_oneshot && !ticked)) {
+		if (!clock_oneshot || deadline != clock_deadline)
+			clock_set_oneshot (deadline);
+	} else if (clock_oneshot)
+		clock_set_periodic ();
+}
+
+/* Programs the clock to interrupt TIMER_FREQ times per second,
+   starting one tick from now. */
+static void
+clock_set_periodic (void) {
+	if (lapic_tick_count != 0) {
+		lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_PERIODIC | 0x20);
+		lapic_write (LAPIC_TIMER_ICR, lapic_tick_count);
+	} else
+		pit_set_periodic ();
+	clock_oneshot = false;
+	next_tick_ns = timer_ns () + TICK_NS;
+}
+
+/* Programs the clock to interrupt once, at timer_ns() time
+   DEADLINE, or oneshot_max_ticks from now if that is sooner. */
+static void
+clock_set_oneshot (int64_t deadline) {
+	int64_t delta = deadline - timer_ns ();
+
+	if (delta < CLOCK_MIN_NS)
+		delta = CLOCK_MIN_NS;
+	if (delta > oneshot_max_ticks * TICK_NS)
+		delta = oneshot_max_ticks * TICK_NS;
+
+	if (lapic_tick_count != 0) {
+		uint64_t hz = (uint64_t) lapic_tick_count * TIMER_FREQ;
+		lapic_write (LAPIC_LVT_TIMER, 0x20);
+		lapic_write (LAPIC_TIMER_ICR, DIV_ROUND_UP (delta * hz, NSEC_PER_SEC));
+	} else {
+		int64_t count = DIV_ROUND_UP (delta * PIT_HZ, NSEC_PER_SEC);
+		pit_set_oneshot (count < PIT_MAX_COUNT ? count : PIT_MAX_COUNT);
+	}
+	clock_oneshot = true;
+	clock_deadline = deadline;
+}
+
+/* Measures the TSC frequency against the longest PIT one-shot.
+   Interrupts must be off and IRQ 0 masked. */
+static void
+tsc_calibrate (void) {
+	uint64_t start;
+
+	pit_set_oneshot (PIT_MAX_COUNT);
+	start = rdtsc ();
+	while (!pit_expired ())
+		continue;
+	tsc_hz = (rdtsc () - start) * PIT_HZ / PIT_MAX_COUNT;
+	ASSERT (tsc_hz > 0);
+
+	tsc_ns_mult = ((uint64_t) NSEC_PER_SEC << 32) / tsc_hz;
+	tsc_base = rdtsc ();
+}
+
+/* Measures how far the local APIC timer counts down during one
+   timer tick, timed by a PIT one-shot.  Interrupts must be off
+   and IRQ 0 masked. */
+static uint32_t
+lapic_timer_calibrate (void) {
+	uint32_t remaining;
+
+	lapic_write (LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+	lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | 0x20);
+
+	pit_set_oneshot (PIT_TICK_COUNT);
+	lapic_write (LAPIC_TIMER_ICR, UINT32_MAX);
+	while (!pit_expired ())
+		continue;
+	remaining = lapic_read (LAPIC_TIMER_CCR);
+	lapic_write (LAPIC_TIMER_ICR, 0);
+
+	return UINT32_MAX - remaining;
+}
+
+/* Programs PIT counter 0 to interrupt TIMER_FREQ times per
+   second. */
+static void
+pit_set_periodic (void) {
+	uint16_t count = PIT_TICK_COUNT;
+
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Programs PIT counter 0 to interrupt once, COUNT PIT input
+   clocks from now. */
+static void
+pit_set_oneshot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns true if the one-shot last programmed into PIT counter
+   0 has reached zero, that is, if its OUT pin is high. */
+static bool
+pit_expired (void) {
+	outb (0x43, 0xe2);    /* Read back status of counter 0. */
+	return (inb (0x40) & 0x80) != 0;
+}
+
+/* Returns the first tick before LIMIT at which the timer wheel
+   may have timers to fire, or LIMIT if there is none.  Ticks at
+   which level 0 wraps around count as busy, since timers from
+   the upper levels are cascaded down then. */
+static int64_t
+wheel_next_event (int64_t limit) {
+	int64_t t;
+
+	for (t = wheel_base; t < limit; t++)
+		if ((t & WHEEL0_MASK) == 0 || !list_empty (&wheel0[t & WHEEL0_MASK]))
+			return t;
+	return limit;
+}
+
+/* Initializes the empty timer wheel. */
+static void
+wheel_init (void) {
+	int level, i;
+
+	for (i = 0; i < WHEEL0_SIZE; i++)
+		list_init (&wheel0[i]);
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		for (i = 0; i < WHEELN_SIZE; i++)
+			list_init (&wheeln[level][i]);
+	wheel_base = 0;
+}
+
+/* Puts T in the wheel slot that covers its expiry.
+   Must be called with interrupts off. */
+static void
+wheel_add (struct timer *t) {
+	int64_t expires = t->expires;
+	int64_t delta = expires - wheel_base;
+	struct list *slot;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (delta < 0) {
+		/* Already expired: run on the next tick processed. */
+		slot = &wheel0[wheel_base & WHEEL0_MASK];
+	} else if (delta < WHEEL0_SIZE) {
+		slot = &wheel0[expires & WHEEL0_MASK];
+	} else {
+		int level, shift;
+
+		/* Too far out for the wheel: park it in the farthest slot.
+		   It is placed again, with its real expiry, on cascade. */
+		if (delta >= WHEEL_SPAN) {
+			delta = WHEEL_SPAN - 1;
+			expires = wheel_base + delta;
 		}
-		// Recalculate priority for all threads every 4th tick
-		if (ticks % 4 == 0)
-			thread_recalc_priority_all ();
+		for (level = 0, shift = WHEEL0_BITS + WHEELN_BITS;
+				delta >= 1LL << shift; level++, shift += WHEELN_BITS)
+			continue;
+		slot = &wheeln[level][(expires >> (shift - WHEELN_BITS)) & WHEELN_MASK];
 	}
-	thread_tick ();
+	list_push_back (slot, &t->elem);
+}
+
+/* Moves the timers in slot INDEX of upper LEVEL down into the
+   lower levels.  Returns INDEX. */
+static int
+wheel_cascade (int level, int index) {
+	struct list *slot = &wheeln[level][index];
+	struct list work;
+
+	list_init (&work);
+	if (!list_empty (slot))
+		list_splice (list_end (&work), list_begin (slot), list_end (slot));
+	while (!list_empty (&work))
+		wheel_add (list_entry (list_pop_front (&work), struct timer, elem));
+	return index;
+}
+
+/* Fires every timer that expired at or before tick NOW.  Runs in
+   the timer softirq with interrupts on, and turns them off only
+   to take each timer off the wheel and call it. */
+static void
+wheel_run (int64_t now) {
+	enum intr_level old_level = intr_disable ();
+
+	while (wheel_base <= now) {
+		int index = wheel_base & WHEEL0_MASK;
+		struct list *slot = &wheel0[index];
+		struct list work;
+
+		/* Level 0 wrapped around: refill it from the levels above. */
+		if (index == 0) {
+			int level, shift;
+			for (level = 0, shift = WHEEL0_BITS; level < WHEEL_LEVELS - 1;
+					level++, shift += WHEELN_BITS)
+				if (wheel_cascade (level, (wheel_base >> shift) & WHEELN_MASK) != 0)
+					break;
+		}
+		wheel_base++;
+
+		/* Detach the slot first, so that callbacks that rearm
+		   their timers do not see them again in this pass.  A
+		   timer still in WORK may be canceled while interrupts are
+		   on, which just takes it out of WORK. */
+		list_init (&work);
+		if (!list_empty (slot))
+			list_splice (list_end (&work), list_begin (slot), list_end (slot));
+		while (!list_empty (&work)) {
+			struct timer *t = list_entry (list_pop_front (&work),
+					struct timer, elem);
+			t->armed = false;
+			t->func (t->aux);
+
+			/* Let pending interrupts in between timers. */
+			intr_set_level (old_level);
+			intr_disable ();
+		}
+	}
+
+	intr_set_level (old_level);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -180,29 +900,3 @@ busy_wait (int64_t loops) {
 	while (loops-- > 0)
 		barrier ();
 }
-
-/* Sleep for approximately NUM/DENOM seconds. */
-static void
-real_time_sleep (int64_t num, int32_t denom) {
-	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
-
-	   (NUM / DENOM) s
-	   ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
-	   1 s / TIMER_FREQ ticks
-	   */
-	int64_t ticks = num * TIMER_FREQ / denom;
-
-	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
-		/* We're waiting for at least one full timer tick.  Use
-		   timer_sleep() because it will yield the CPU to other
-		   processes. */
-		timer_sleep (ticks);
-	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
-	}
-}
\ No newline at end of file
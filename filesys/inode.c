@@ -6,6 +6,8 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,6 +35,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct rwlock rwlock;               /* Guards the contents, for directories. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -50,13 +53,23 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
+ * returns the same `struct inode'.  Opens that find their inode
+ * already in the list only read it, so they hold the list's lock
+ * for reading and do not serialize behind each other. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
+
+/* Cache of in-memory inodes. */
+static struct kmem_cache *inode_cache;
+
+static struct inode *find_open_inode (disk_sector_t);
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	rwlock_init (&open_inodes_lock);
+	inode_cache = kmem_cache_create ("inode", sizeof (struct inode), 0, NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -101,23 +114,37 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
 	struct inode *inode;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
+	rwlock_read_acquire (&open_inodes_lock);
+	inode = find_open_inode (sector);
+	if (inode != NULL) {
+		__atomic_fetch_add (&inode->open_cnt, 1, __ATOMIC_RELAXED);
+		rwlock_read_release (&open_inodes_lock);
+		return inode;
+	}
+
+	/* Take the list for writing.  An upgrade lets no other writer
+	 * in, so the inode cannot have been opened meanwhile; if another
+	 * opener is already upgrading, wait for the list and look again. */
+	if (!rwlock_upgrade (&open_inodes_lock)) {
+		rwlock_read_release (&open_inodes_lock);
+		rwlock_write_acquire (&open_inodes_lock);
+		inode = find_open_inode (sector);
+		if (inode != NULL) {
+			inode->open_cnt++;
+			rwlock_write_release (&open_inodes_lock);
+			return inode;
 		}
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	inode = kmem_cache_alloc (inode_cache);
+	if (inode == NULL) {
+		rwlock_write_release (&open_inodes_lock);
 		return NULL;
+	}
 
 	/* Initialize. */
 	list_push_front (&open_inodes, &inode->elem);
@@ -125,15 +152,36 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	rwlock_init (&inode->rwlock);
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	rwlock_write_release (&open_inodes_lock);
 	return inode;
 }
 
+/* Returns the open inode for SECTOR, or a null pointer if there
+ * is none.  The caller must hold OPEN_INODES_LOCK. */
+static struct inode *
+find_open_inode (disk_sector_t sector) {
+	struct list_elem *e;
+
+	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+			e = list_next (e)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+		if (inode->sector == sector)
+			return inode;
+	}
+	return NULL;
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
-		inode->open_cnt++;
+	if (inode != NULL) {
+		/* Other readers may reopen INODE at the same time. */
+		rwlock_read_acquire (&open_inodes_lock);
+		__atomic_fetch_add (&inode->open_cnt, 1, __ATOMIC_RELAXED);
+		rwlock_read_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -143,6 +191,14 @@ inode_get_inumber (const struct inode *inode) {
 	return inode->sector;
 }
 
+/* Returns the lock that guards INODE's contents.  Directories
+ * hold it for reading during lookups and for writing while they
+ * change an entry. */
+struct rwlock *
+inode_get_rwlock (struct inode *inode) {
+	return &inode->rwlock;
+}
+
 /* Closes INODE and writes it to disk.
  * If this was the last reference to INODE, frees its memory.
  * If INODE was also a removed inode, frees its blocks. */
@@ -153,19 +209,24 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
-
-		/* Deallocate blocks if removed. */
-		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
-		}
+	rwlock_write_acquire (&open_inodes_lock);
+	if (--inode->open_cnt > 0) {
+		rwlock_write_release (&open_inodes_lock);
+		return;
+	}
+
+	/* Remove from inode list and release lock. */
+	list_remove (&inode->elem);
+	rwlock_write_release (&open_inodes_lock);
 
-		free (inode); 
+	/* Deallocate blocks if removed. */
+	if (inode->removed) {
+		free_map_release (inode->sector, 1);
+		free_map_release (inode->data.start,
+				bytes_to_sectors (inode->data.length)); 
 	}
+
+	kmem_cache_free (inode_cache, inode);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
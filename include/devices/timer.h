@@ -1,23 +1,77 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* If true, the periodic tick is stopped while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
 void timer_init (void);
+void timer_init_ap (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+int64_t timer_ns (void);
+uint64_t timer_cycles (void);
+uint64_t timer_cycles_per_sec (void);
+
 void timer_sleep (int64_t ticks);
+void timer_sleep_until (int64_t tick);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
+void timer_nsleep_until (int64_t deadline_ns);
 
 void timer_print_stats (void);
 
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+/* Kernel timer.  Once armed, FUNC (AUX) is called from the timer
+   softirq that follows the first tick at or after EXPIRES (or,
+   after a tickless idle period, from the idle thread catching up
+   on missed ticks).  The callback runs in interrupt context with
+   interrupts off, so it must not sleep; it may rearm its own
+   timer. */
+typedef void timer_func (void *aux);
+
+struct timer {
+	struct list_elem elem;      /* Element in a timer wheel slot. */
+	int64_t expires;            /* Absolute tick to fire at. */
+	timer_func *func;           /* Callback. */
+	void *aux;                  /* Argument for FUNC. */
+	bool armed;                 /* Queued in the timer wheel? */
+};
+
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_arm (struct timer *, int64_t expires);
+bool timer_cancel (struct timer *);
+bool timer_pending (const struct timer *);
+
+/* High-resolution timer.  Like struct timer, but EXPIRES is a
+   timer_ns() time, and the timer interrupt is programmed to fire
+   at that moment instead of at the next tick.  The callback runs
+   under the same rules as a struct timer's. */
+struct hrtimer {
+	struct list_elem elem;      /* Element in the hrtimer list. */
+	int64_t expires;            /* Absolute timer_ns() to fire at. */
+	timer_func *func;           /* Callback. */
+	void *aux;                  /* Argument for FUNC. */
+	bool armed;                 /* Queued in the hrtimer list? */
+};
+
+void hrtimer_setup (struct hrtimer *, timer_func *, void *aux);
+void hrtimer_arm (struct hrtimer *, int64_t expires);
+bool hrtimer_cancel (struct hrtimer *);
+bool hrtimer_pending (const struct hrtimer *);
+
 #endif /* devices/timer.h */
@@ -36,6 +36,30 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* CPU bandwidth control. */
+	SYS_CPU_QUOTA,              /* Limit the CPU time of this process. */
+
+	/* Fast user-space locking. */
+	SYS_FUTEX,                  /* Wait on or wake a user word. */
+
+	/* Threads sharing one process. */
+	SYS_THREAD_CREATE,          /* Start a thread in this process. */
+	SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+	SYS_THREAD_EXIT,            /* Exit only the calling thread. */
+	SYS_THREAD_DETACH,          /* Let a thread exit without a join. */
 };
 
+/* Operations for SYS_FUTEX. */
+enum futex_op {
+	FUTEX_WAIT,                 /* Sleep if *UADDR still equals VAL. */
+	FUTEX_WAKE,                 /* Wake up to VAL waiters on UADDR. */
+	FUTEX_REQUEUE,              /* Wake VAL, move up to VAL2 to UADDR2. */
+};
+
+/* Errors from SYS_FUTEX.  Only FUTEX_EAGAIN means that the
+   caller should re-read the word and retry. */
+#define FUTEX_EAGAIN (-1)       /* *UADDR no longer held VAL. */
+#define FUTEX_EINVAL (-2)       /* Bad operation or address. */
+
 #endif /* lib/syscall-nr.h */
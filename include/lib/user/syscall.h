@@ -9,6 +9,14 @@
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
+/* A thread's initial function, whose return value becomes its
+   exit status. */
+typedef int thread_func (void *aux);
+
 /* Map region identifier. */
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
@@ -50,6 +58,19 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* CPU bandwidth control. */
+int cpu_quota (int quota, int period);
+
+/* Fast user-space locking.  OP is one of the FUTEX_* operations
+   in <syscall-nr.h>, which also lists the errors returned. */
+int futex (int *uaddr, int op, int val, int *uaddr2, int val2);
+
+/* Threads sharing this process. */
+tid_t thread_create (thread_func *, void *aux);
+int thread_join (tid_t);
+int thread_detach (tid_t);
+void thread_exit (int status) NO_RETURN;
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,47 @@
+#ifndef THREADS_APIC_H
+#define THREADS_APIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Local APIC register offsets, in bytes from the MMIO base.
+   See [IA32-v3a] section 10.4.1 "The Local APIC Block Diagram". */
+#define LAPIC_ID        0x020   /* Local APIC ID. */
+#define LAPIC_VER       0x030   /* Local APIC version. */
+#define LAPIC_EOI       0x0b0   /* End of interrupt. */
+#define LAPIC_SVR       0x0f0   /* Spurious interrupt vector. */
+#define LAPIC_ICR_LO    0x300   /* Interrupt command, low half. */
+#define LAPIC_ICR_HI    0x310   /* Interrupt command, high half. */
+#define LAPIC_LVT_TIMER 0x320   /* LVT timer entry. */
+#define LAPIC_LVT_LINT0 0x350   /* LVT LINT0 entry. */
+#define LAPIC_LVT_LINT1 0x360   /* LVT LINT1 entry. */
+#define LAPIC_TIMER_ICR 0x380   /* Timer initial count. */
+#define LAPIC_TIMER_CCR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DCR 0x3e0   /* Timer divide configuration. */
+
+/* LVT entry bits. */
+#define LAPIC_LVT_MASKED   0x00010000   /* Interrupt masked. */
+#define LAPIC_LVT_PERIODIC 0x00020000   /* Timer: periodic mode. */
+
+/* Vector for spurious local APIC interrupts. */
+#define LAPIC_SPURIOUS_VEC 0xff
+
+/* Vectors for interprocessor interrupts. */
+#define LAPIC_RESCHED_VEC 0xf0  /* Check for preemption. */
+#define LAPIC_TLB_VEC     0xf1  /* Flush the TLB. */
+#define LAPIC_CLOCK_VEC   0xf2  /* Reprogram the BSP's clock. */
+
+bool lapic_init (void);
+bool lapic_present (void);
+uint32_t lapic_read (uint32_t reg);
+void lapic_write (uint32_t reg, uint32_t value);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+void lapic_send_init (void);
+void lapic_send_startup (uint64_t paddr);
+void lapic_send_ipi (uint8_t lapic_id, uint8_t vec);
+
+bool ioapic_init (void);
+void ioapic_route (int irq, uint8_t vec);
+
+#endif /* threads/apic.h */
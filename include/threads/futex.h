@@ -0,0 +1,15 @@
+#ifndef THREADS_FUTEX_H
+#define THREADS_FUTEX_H
+
+#include <stdint.h>
+
+struct thread;
+
+void futex_init (void);
+int futex_wait (uint32_t *word, uint32_t val);
+int futex_wake (uint32_t *word, int cnt);
+int futex_requeue (uint32_t *word, int wake_cnt,
+		uint32_t *word2, int move_cnt);
+void futex_cancel (struct thread *);
+
+#endif /* threads/futex.h */
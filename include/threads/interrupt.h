@@ -65,10 +65,22 @@ struct intr_frame {
 
 typedef void intr_handler_func (struct intr_frame *);
 
+/* If true, use the 8259A PICs even if the machine has APICs.
+   Controlled by kernel command-line option "-pic". */
+extern bool intr_force_pic;
+
+/* Global interrupt lock, held by the CPU whose interrupts are
+   off.  See interrupt.c. */
+extern volatile int intr_lock;
+
 void intr_init (void);
+void intr_init_ap (void);
+void intr_lock_acquire (void);
+void intr_lock_release (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
+bool intr_apic_enabled (void);
 bool intr_context (void);
 void intr_yield_on_return (void);
 
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -18,6 +19,11 @@ uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
+bool palloc_extend (void *pages, size_t page_cnt, size_t extra_cnt);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_get_batch (enum palloc_flags, void **pages, size_t page_cnt);
+void palloc_free_batch (void **pages, size_t page_cnt);
+bool palloc_zero_idle (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
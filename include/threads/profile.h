@@ -0,0 +1,33 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* Sampling profiler.
+
+   While enabled, the timer interrupt records the code it
+   interrupted PROFILE_HZ times a second, as the interrupted RIP
+   followed by the return addresses found by walking the kernel's
+   frame pointers, in a histogram of distinct call stacks.
+   utils/profile-fold turns a dump of the histogram into folded
+   stacks for flame graphs. */
+
+/* Samples per second, or 0 if profiling is off.
+   Set by the kernel command-line option "-profile[=HZ]". */
+extern int profile_hz;
+
+/* Sampling rate used by "-profile" without a value. */
+#define PROFILE_HZ_DEFAULT 1000
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_stop (void);
+void profile_print (void);
+#ifdef FILESYS
+void profile_save (const char *file_name);
+#endif
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,56 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+struct task_state;
+
+/* Maximum number of CPUs supported. */
+#define CPU_MAX 16
+
+/* Per-CPU data.  Each CPU finds its own through the running
+   thread: see cpu_current(). */
+struct cpu {
+	/* Used by syscall_entry, which finds them through %gs at
+	   these offsets.  Keep them first. */
+	uint64_t syscall_scratch[2];        /* Offset 0: user %rbx, %r12. */
+	struct task_state *tss;             /* Offset 16: this CPU's TSS. */
+
+	int id;                             /* Index into cpus[]; 0 is the BSP. */
+	uint8_t lapic_id;                   /* Local APIC ID. */
+	volatile bool online;               /* Running threads? */
+
+	/* Owned by thread.c. */
+	struct thread *curr;                /* Running thread. */
+	struct thread *idle_thread;         /* Runs when nothing else can. */
+	unsigned thread_ticks;              /* # of timer ticks since last yield. */
+	unsigned balance_ticks;             /* # of timer ticks since last balance. */
+
+	/* Owned by interrupt.c and softirq.c. */
+	bool in_external_intr;              /* Processing an external interrupt? */
+	bool yield_on_return;               /* Yield on interrupt return? */
+	bool in_softirq;                    /* Running softirq handlers? */
+
+	/* Owned by smp.c. */
+	uint64_t cr3;                       /* Page table in use. */
+	volatile bool tlb_flush;            /* Must flush the TLB. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs to bring up.
+   Set by the kernel command-line option "-smp=N". */
+extern int smp_cpu_cnt;
+
+void smp_init (void);
+int smp_online_cnt (void);
+struct cpu *cpu_current (void);
+bool cpu_is_bsp (void);
+
+void smp_send_resched (struct cpu *);
+void smp_tlb_shootdown (uint64_t cr3);
+void smp_tlb_flush_pending (void);
+
+#endif /* threads/smp.h */
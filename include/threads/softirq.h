@@ -0,0 +1,28 @@
+#ifndef THREADS_SOFTIRQ_H
+#define THREADS_SOFTIRQ_H
+
+#include <stdbool.h>
+
+/* Softirqs: deferred halves of interrupt handlers.
+
+   An interrupt handler does only what cannot wait and raises a
+   softirq for the rest.  Raised softirqs run right after the
+   interrupt is acknowledged, still in interrupt context (they
+   must not sleep), but with interrupts turned back on, so that
+   other interrupts are not held off while they run. */
+enum softirq_nr {
+	SOFTIRQ_TIMER,              /* Timer wheel expiry. */
+	SOFTIRQ_SCHED,              /* Scheduler bookkeeping (MLFQS). */
+	SOFTIRQ_DISK,               /* Disk command completions. */
+	SOFTIRQ_SERIAL,             /* Serial port transfers. */
+	SOFTIRQ_CNT                 /* Number of softirqs. */
+};
+
+typedef void softirq_func (void);
+
+void softirq_register (enum softirq_nr, softirq_func *);
+void softirq_raise (enum softirq_nr);
+void softirq_run (void);
+bool softirq_context (void);
+
+#endif /* threads/softirq.h */
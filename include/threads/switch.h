@@ -0,0 +1,13 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Switches from the running thread to another, saving the
+   current thread's stack pointer in *CUR_RSP.  See switch.S. */
+void thread_switch (uint64_t *cur_rsp, uint64_t next_rsp,
+		struct intr_frame *next_tf);
+
+#endif /* threads/switch.h */
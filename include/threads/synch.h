@@ -1,13 +1,79 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+struct thread;
+
+/* Priority wait queue.  Holds blocked threads in a pairing heap
+   ordered by priority, highest first, and by arrival among
+   threads of equal priority.  Each thread has one waitq_elem, so
+   it can be in at most one wait queue at a time. */
+struct waitq_elem {
+	struct heap_elem elem;      /* Node in the wait queue's heap. */
+	uint64_t seq;               /* Arrival order. */
+};
+
+struct waitq {
+	struct heap heap;           /* Waiters, highest priority on top. */
+};
+
+void waitq_init (struct waitq *);
+bool waitq_empty (const struct waitq *);
+struct thread *waitq_top (const struct waitq *);
+void waitq_push (struct waitq *, struct thread *);
+struct thread *waitq_pop (struct waitq *);
+void waitq_remove (struct thread *);
+void waitq_reprioritize (struct thread *);
+
+/* Something held by a thread that other threads can wait for,
+   for priority donation.  It sits in the holder's `held_locks'
+   heap, keyed by the highest priority among WAITERS. */
+struct lock_hold {
+	struct heap_elem elem;      /* Node in the holder's `held_locks'. */
+	struct waitq *waiters;      /* Threads waiting for it. */
+};
+
+int lock_hold_priority (const struct lock_hold *);
+
+#ifdef LOCKSTAT
+/* Contention statistics, kept when the kernel is built with
+   -DLOCKSTAT for each place in the code that initializes a lock
+   or semaphore.  All the locks initialized at one place share
+   one `struct lockstat', so statistics for locks embedded in
+   many objects add up rather than being lost when the objects
+   are freed.  Times are in TSC cycles. */
+struct lockstat {
+	const char *name;           /* Expression that was initialized. */
+	const char *file;           /* Where it was initialized. */
+	int line;
+	uint64_t acquired;          /* Number of acquisitions. */
+	uint64_t contended;         /* Acquisitions that had to wait. */
+	uint64_t wait_total;        /* Cycles spent waiting. */
+	uint64_t wait_max;
+	uint64_t hold_total;        /* Cycles held, for locks only. */
+	uint64_t hold_max;
+	struct lockstat *next;      /* Next in the registry, once listed. */
+	bool registered;            /* In the registry? */
+};
+
+#define LOCKSTAT_INITIALIZER(NAME) \
+	{ .name = (NAME), .file = __FILE__, .line = __LINE__ }
+
+void lockstat_print (void);
+#endif
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct waitq waiters;       /* Waiting threads. */
+#ifdef LOCKSTAT
+	struct lockstat *stat;      /* Statistics, or null. */
+#endif
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,6 +86,10 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct lock_hold hold;      /* Entry in the holder's `held_locks'. */
+#ifdef LOCKSTAT
+	uint64_t hold_start;        /* When the holder acquired it. */
+#endif
 };
 
 void lock_init (struct lock *);
@@ -30,15 +100,86 @@ bool lock_held_by_current_thread (const struct lock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct waitq waiters;       /* Waiting threads. */
 };
 
+#ifdef LOCKSTAT
+void lockstat_attach (struct semaphore *, struct lockstat *);
+
+/* With statistics on, every call site of sema_init() and
+   lock_init() gets its own `struct lockstat'.  The parentheses
+   around the function names keep them from expanding again. */
+#define sema_init(SEMA, VALUE) ({ \
+	static struct lockstat lockstat_ = LOCKSTAT_INITIALIZER (#SEMA); \
+	struct semaphore *sema_ = (SEMA); \
+	(sema_init) (sema_, VALUE); \
+	lockstat_attach (sema_, &lockstat_); \
+})
+#define lock_init(LOCK) ({ \
+	static struct lockstat lockstat_ = LOCKSTAT_INITIALIZER (#LOCK); \
+	struct lock *lock_ = (LOCK); \
+	(lock_init) (lock_); \
+	lockstat_attach (&lock_->semaphore, &lockstat_); \
+})
+#endif
+
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-bool cmp_priority_greater_sema (struct list_elem *e1, struct list_elem *e2);	// privately added
+/* Readers-writer lock.  Any number of readers, or a single
+   writer, may hold it at a time.  A writer that is waiting keeps
+   new readers out, so writers are not starved.  Waiters donate
+   priority to every holder. */
+struct rwlock {
+	struct thread *writer;      /* Thread holding it for writing, or null. */
+	struct lock_hold write_hold; /* Writer's entry in its `held_locks'. */
+	unsigned reader_cnt;        /* Number of threads holding it for reading. */
+	struct list readers;        /* Read holds, as `struct rwlock_read'. */
+	unsigned writers_waiting;   /* Number of writers in `waiters'. */
+	struct thread *upgrader;    /* Reader waiting in rwlock_upgrade(). */
+	struct waitq waiters;       /* Waiting readers and writers. */
+};
+
+/* A thread's hold on an rwlock for reading.  Each thread has
+   RWLOCK_READ_MAX of these, so that is the most rwlocks a thread
+   may hold for reading at once.  Acquiring one more for reading
+   is a kernel bug, caught by an assertion. */
+#define RWLOCK_READ_MAX 4
+struct rwlock_read {
+	struct rwlock *rwlock;      /* Rwlock held, or null if unused. */
+	struct thread *thread;      /* Thread holding it. */
+	struct lock_hold hold;      /* Entry in the thread's `held_locks'. */
+	struct list_elem elem;      /* Element in the rwlock's `readers'. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+bool rwlock_try_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+bool rwlock_try_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+bool rwlock_upgrade (struct rwlock *);
+bool rwlock_try_upgrade (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+void rwlock_donate (struct rwlock *);
+
+/* Spinlock.  Busy-waits instead of sleeping, so it may be held
+   where blocking is not allowed, including interrupt context.
+   Interrupts stay disabled on the holding CPU, so a spinlock is
+   always taken inside the global interrupt lock (see
+   interrupt.c). */
+struct spinlock {
+	volatile int locked;        /* Nonzero while held. */
+	enum intr_level old_level;  /* Interrupt level to restore. */
+};
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
 
 /* Optimization barrier.
  *
@@ -3,13 +3,21 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
 
+struct cpu;
+struct cpu_group;
+struct process;
+struct exit_record;
+
 /* States in a thread's life cycle. */
 enum thread_status {
 	THREAD_RUNNING,     /* Running thread. */
@@ -28,6 +36,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice to other threads. */
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -79,12 +92,10 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an element in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+ * Threads waiting on a semaphore or condition variable are kept
+ * in a priority wait queue (synch.c) through `wq_elem' instead,
+ * so that a donation can re-key a waiter in place. */
 struct thread {
 	/* Owned by thread.c. */
 	tid_t tid;                          /* Thread identifier. */
@@ -94,14 +105,42 @@ struct thread {
 
 	// Privately added
 	int original_priority;				// Original priority of 
-	int64_t ticks_to_wakeup;			// Storing ticks till wakeup
-	struct list donor_list;				// List of priority donors for multiple donation
-	struct list_elem d_elem;			// List elem for 'donor_list'
+	struct timer sleep_timer;			// Wakes the thread up from thread_sleep ()
+	struct heap held_locks;				// Locks held by the thread, the one with the highest waiter on top
 	struct lock *lock_waiting;			// Pointer of lock that a thread is waiting to acquire
+	struct rwlock *rwlock_waiting;		// Pointer of rwlock that a thread is waiting to acquire
+	bool rwlock_writing;				// Whether it waits for 'rwlock_waiting' to write
+	struct rwlock_read rw_reads[RWLOCK_READ_MAX];	// Holds on rwlocks the thread is reading
+	struct waitq *waitq;				// Wait queue of semaphore or condition the thread is waiting on, if any
+	struct waitq_elem wq_elem;			// Node in 'waitq'
+	uintptr_t futex_key;				// Kernel address of the futex word the thread is waiting on, if any
 
 	int nice;							// 'Niceness' of thread to other threads
 	int fixed_recent_cpu;				// Stores fixed scaled ticks recently used by the thread, incrementing per each timer tick
-	struct list_elem t_elem;			// List elem for 'List of all threads'
+	int64_t recent_cpu_seconds;			// Last once-per-second decay applied to fixed_recent_cpu
+	struct list_elem decay_elem;		// Node in the decay bucket of recent_cpu_seconds, while blocked
+	bool decay_blocked;					// Whether 'decay_elem' is in a decay bucket
+
+	struct rb_elem cfs_elem;			// Node in the cfs run queue, ordered by vruntime
+	int64_t vruntime;					// Run time in ns, scaled by the weight of 'nice'
+	int64_t exec_start;					// timer_ns () when the thread was last charged for its run time
+	int64_t slice_start;				// timer_ns () when the thread was last scheduled
+
+	int64_t dl_runtime;					// Budget of ticks per period, or 0 if not a deadline thread
+	int64_t dl_period;					// Period in ticks
+	int64_t dl_rel_deadline;			// Deadline of each job in ticks, relative to its release
+	int64_t dl_release;					// Tick the current job was released at
+	int64_t dl_deadline;				// Absolute deadline of the current job, the key in the edf run queue
+	int64_t dl_budget;					// Ticks left of the current period's budget
+	bool dl_throttled;					// Blocked until the next period for overrunning its budget?
+	unsigned dl_misses;					// # of jobs that missed their deadline
+	struct timer dl_timer;				// Releases the next job
+	struct rb_elem dl_elem;				// Node in the edf run queue
+
+	struct cpu_group *cpu_group;		// CPU bandwidth group, or null if the thread's CPU time is not limited
+	struct cpu_group *cpu_throttled;	// Group whose runtime the thread used up, if any
+
+	struct cpu *cpu;					// CPU the thread runs on, or whose run queue it is in
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
@@ -109,6 +148,11 @@ struct thread {
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
+	struct process *process;            /* Process this thread runs in. */
+	struct list_elem proc_elem;         /* Element in process's threads. */
+	struct exit_record *exit_rec;       /* Where to leave exit status. */
+	int stack_slot;                     /* Index of user stack region. */
+
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
@@ -116,7 +160,8 @@ struct thread {
 #endif
 
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching */
+	struct intr_frame tf;               /* Context for the first launch. */
+	uint64_t switch_rsp;                /* Saved stack pointer, 0 if never switched out. */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
@@ -125,19 +170,32 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which shares the
+   CPU among runnable threads in proportion to weights derived
+   from their nice values.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
+void thread_init_ap (void); // privately added
+void thread_start_ap (void) NO_RETURN; // privately added
+struct thread *thread_create_idle (struct cpu *); // privately added
 
 void thread_tick (void);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_deadline (const char *name, int64_t runtime,
+		int64_t period, int64_t deadline, thread_func *, void *); // privately added
+void thread_wait_next_period (void); // privately added
+unsigned thread_deadline_misses (void); // privately added
+int thread_set_cpu_quota (int64_t quota, int64_t period); // privately added
 
 void thread_block (void);
 void thread_unblock (struct thread *);
 void thread_sleep (int64_t ticks); // privately added
-void thread_wakeup (int64_t ticks); // privately added
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -152,14 +210,14 @@ int thread_get_priority (void);
 void thread_set_priority (int);
 void thread_donate_priority (void); // privately added
 void thread_update_priority (void); // privately added
-void thread_remove_donor (struct lock *lock); // privately added
+void thread_donate_to (struct thread *holder, struct lock_hold *hold); // privately added
 
 // for mlfqs
 void thread_recalc_priority (struct thread *t); // privately added
-void thread_recalc_priority_all (void); // privately added
+void thread_recalc_priority_running (void); // privately added
 void thread_recalc_load_avg (void); // privately added
 void thread_recalc_recent_cpu (struct thread *t); // privately added
-void thread_recalc_recent_cpu_all (void); // privately added
+void thread_recalc_recent_cpu_runnable (void); // privately added
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -168,7 +226,4 @@ int thread_get_load_avg (void);
 
 void do_iret (struct intr_frame *tf);
 
-bool cmp_priority_greater (struct list_elem *e1, struct list_elem *e2); // privately added
-bool cmp_priority_greater_dona (struct list_elem *e1, struct list_elem *e2); // privately added
-
 #endif /* threads/thread.h */
@@ -0,0 +1,44 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+
+/* Workqueues: work deferred to kernel threads.
+
+   Unlike a softirq, work runs in a worker thread, so it may
+   sleep, take locks and do I/O, and it is scheduled at the
+   priority the workqueue was created with.  Work can be queued
+   from anywhere, including interrupt handlers. */
+
+typedef void work_func (void *aux);
+
+/* A unit of work.  The owner embeds it and keeps it alive while
+   it is queued or running. */
+struct work {
+	struct list_elem elem;      /* Element in the workqueue's list. */
+	work_func *func;            /* Function to call. */
+	void *aux;                  /* Argument for FUNC. */
+	bool pending;               /* Queued and not started yet? */
+};
+
+/* A queue of work and the worker threads that run it.  A
+   workqueue is never destroyed, since its workers run forever. */
+struct workqueue {
+	const char *name;           /* Name of the worker threads. */
+	struct list works;          /* Pending work, oldest first. */
+	struct semaphore ready;     /* Wakes up workers for pending work. */
+	unsigned busy;              /* Number of pending and running works. */
+	struct waitq flushers;      /* Threads in workqueue_flush(). */
+};
+
+bool workqueue_create (struct workqueue *, const char *name,
+		int priority, int worker_cnt);
+void workqueue_flush (struct workqueue *);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct workqueue *, struct work *);
+bool work_cancel (struct workqueue *, struct work *);
+
+#endif /* threads/workqueue.h */
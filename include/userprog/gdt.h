@@ -2,6 +2,11 @@
 #define USERPROG_GDT_H
 
 #include "threads/loader.h"
+#include "threads/smp.h"
+
+/* Task-state segment of CPU ID.  Each takes two GDT entries, the
+   first CPU's at SEL_TSS. */
+#define SEL_TSS_CPU(ID) (SEL_TSS + 16 * (ID))
 
 void gdt_init (void);
 
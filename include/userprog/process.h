@@ -10,4 +10,10 @@ int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
 
+tid_t process_thread_create (uintptr_t entry, uint64_t arg0, uint64_t arg1);
+int process_thread_join (tid_t);
+int process_thread_detach (tid_t);
+void process_thread_exit (int status) NO_RETURN;
+bool process_exiting (void);
+
 #endif /* userprog/process.h */
@@ -0,0 +1,151 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Pairing heap, see heap.h.
+
+   Each element points to its first child, and the children of an
+   element form a doubly linked sibling list.  The PREV pointer of
+   a first child points to its parent instead of to a sibling,
+   and the root has neither siblings nor a parent.  Every element
+   is no less than its parent. */
+
+static struct heap_elem *meld (struct heap *, struct heap_elem *,
+		struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) {
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap) {
+	return heap->root == NULL;
+}
+
+/* Returns the least element in HEAP, or a null pointer if HEAP
+   is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap) {
+	return heap->root;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = meld (heap, heap->root, elem);
+}
+
+/* Removes and returns the least element in HEAP, which must not
+   be empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) {
+	struct heap_elem *top = heap->root;
+
+	ASSERT (top != NULL);
+	heap->root = merge_pairs (heap, top->child);
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) {
+	struct heap_elem *sub;
+
+	if (heap->root == elem) {
+		heap_pop (heap);
+		return;
+	}
+
+	/* Unlink ELEM's subtree from its parent or left sibling. */
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->next;
+	else
+		elem->prev->next = elem->next;
+	if (elem->next != NULL)
+		elem->next->prev = elem->prev;
+
+	/* ELEM's children are no less than the root, so they can go
+	   straight back into the heap. */
+	sub = merge_pairs (heap, elem->child);
+	heap->root = meld (heap, heap->root, sub);
+}
+
+/* Moves ELEM, which must be in HEAP, to its place after a change
+   to its key. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) {
+	if (heap->root == elem && elem->child == NULL)
+		return;
+
+	heap_remove (heap, elem);
+	heap_push (heap, elem);
+}
+
+/* Melds the heaps rooted at A and B, either of which may be
+   null, and returns the root of the result. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (heap->less (b, a, heap->aux)) {
+		struct heap_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* Make B the first child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	a->next = a->prev = NULL;
+	return a;
+}
+
+/* Combines the sibling list starting at FIRST into one heap with
+   the standard two-pass pairing: meld siblings pairwise from
+   left to right, then meld the pairs from right to left.
+   Returns the root, or a null pointer if FIRST is null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL, *result = NULL;
+
+	/* First pass.  Pairs are chained through NEXT, most recent
+	   first, so that the second pass goes right to left. */
+	while (first != NULL) {
+		struct heap_elem *a = first, *b = first->next;
+		struct heap_elem *pair;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+		pair = meld (heap, a, b);
+		pair->next = pairs;
+		pairs = pair;
+	}
+
+	/* Second pass. */
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+		pairs->next = NULL;
+		result = meld (heap, result, pairs);
+		pairs = next;
+	}
+	return result;
+}
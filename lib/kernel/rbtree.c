@@ -0,0 +1,296 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree, see rbtree.h.
+
+   Missing children are null pointers and count as black.  The
+   tree keeps the usual invariants: the root is black, a red
+   element has no red child, and every path from an element down
+   to a missing child passes through the same number of black
+   elements.  Together they bound the height by 2 log2 (n + 1). */
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+		struct rb_elem *parent);
+
+/* Returns true if E is a red element, false if it is black or
+   missing. */
+static inline bool
+is_red (const struct rb_elem *e) {
+	return e != NULL && e->red;
+}
+
+/* Initializes TREE as an empty tree ordered by LESS given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux) {
+	ASSERT (tree != NULL);
+	ASSERT (less != NULL);
+
+	tree->root = NULL;
+	tree->first = NULL;
+	tree->less = less;
+	tree->aux = aux;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree) {
+	return tree->root == NULL;
+}
+
+/* Returns the least element in TREE, or a null pointer if TREE is
+   empty. */
+struct rb_elem *
+rb_first (const struct rb_tree *tree) {
+	return tree->first;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest. */
+struct rb_elem *
+rb_next (const struct rb_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e->right != NULL) {
+		e = e->right;
+		while (e->left != NULL)
+			e = e->left;
+		return (struct rb_elem *) e;
+	}
+	while (e->parent != NULL && e == e->parent->right)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Inserts ELEM into TREE, after any elements equal to it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_elem *elem) {
+	struct rb_elem *parent = NULL;
+	struct rb_elem **link = &tree->root;
+	bool leftmost = true;
+
+	ASSERT (tree != NULL);
+	ASSERT (elem != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (tree->less (elem, parent, tree->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	elem->parent = parent;
+	elem->left = elem->right = NULL;
+	elem->red = true;
+	*link = elem;
+	if (leftmost)
+		tree->first = elem;
+
+	insert_fixup (tree, elem);
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_elem *elem) {
+	struct rb_elem *child, *parent;
+	bool was_red;
+
+	ASSERT (tree != NULL);
+	ASSERT (elem != NULL);
+
+	if (tree->first == elem)
+		tree->first = rb_next (elem);
+
+	if (elem->left == NULL || elem->right == NULL) {
+		/* ELEM has at most one child, which takes its place. */
+		child = elem->left != NULL ? elem->left : elem->right;
+		parent = elem->parent;
+		was_red = elem->red;
+		replace_child (tree, parent, elem, child);
+		if (child != NULL)
+			child->parent = parent;
+	} else {
+		/* ELEM's successor NEXT has no left child.  NEXT is taken
+		   out of its place and put into ELEM's, with ELEM's color,
+		   so the fixup starts from NEXT's old place. */
+		struct rb_elem *next = elem->right;
+		while (next->left != NULL)
+			next = next->left;
+
+		child = next->right;
+		was_red = next->red;
+		if (next->parent == elem)
+			parent = next;
+		else {
+			parent = next->parent;
+			parent->left = child;
+			if (child != NULL)
+				child->parent = parent;
+			next->right = elem->right;
+			next->right->parent = next;
+		}
+		next->left = elem->left;
+		next->left->parent = next;
+		next->parent = elem->parent;
+		next->red = elem->red;
+		replace_child (tree, elem->parent, elem, next);
+	}
+
+	if (!was_red)
+		remove_fixup (tree, child, parent);
+}
+
+/* Makes NEW take OLD's place as a child of PARENT, or as the root
+   of TREE if PARENT is null. */
+static void
+replace_child (struct rb_tree *tree, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new) {
+	if (parent == NULL)
+		tree->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+/* Rotates E's right child into E's place. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_elem *e) {
+	struct rb_elem *r = e->right;
+
+	e->right = r->left;
+	if (r->left != NULL)
+		r->left->parent = e;
+	r->parent = e->parent;
+	replace_child (tree, e->parent, e, r);
+	r->left = e;
+	e->parent = r;
+}
+
+/* Rotates E's left child into E's place. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_elem *e) {
+	struct rb_elem *l = e->left;
+
+	e->left = l->right;
+	if (l->right != NULL)
+		l->right->parent = e;
+	l->parent = e->parent;
+	replace_child (tree, e->parent, e, l);
+	l->right = e;
+	e->parent = l;
+}
+
+/* Restores the invariants after E was inserted red. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_elem *e) {
+	while (is_red (e->parent)) {
+		struct rb_elem *parent = e->parent;
+		struct rb_elem *grand = parent->parent;
+
+		if (parent == grand->left) {
+			struct rb_elem *uncle = grand->right;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grand->red = true;
+				e = grand;
+				continue;
+			}
+			if (e == parent->right) {
+				rotate_left (tree, parent);
+				e = parent;
+				parent = e->parent;
+			}
+			parent->red = false;
+			grand->red = true;
+			rotate_right (tree, grand);
+		} else {
+			struct rb_elem *uncle = grand->left;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grand->red = true;
+				e = grand;
+				continue;
+			}
+			if (e == parent->left) {
+				rotate_right (tree, parent);
+				e = parent;
+				parent = e->parent;
+			}
+			parent->red = false;
+			grand->red = true;
+			rotate_left (tree, grand);
+		}
+	}
+	tree->root->red = false;
+}
+
+/* Restores the invariants after a black element was removed from
+   between PARENT and its child E, which may be null.  Every path
+   through E is one black element short. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_elem *e,
+		struct rb_elem *parent) {
+	while (e != tree->root && !is_red (e)) {
+		if (e == parent->left) {
+			struct rb_elem *sibling = parent->right;
+			if (is_red (sibling)) {
+				sibling->red = false;
+				parent->red = true;
+				rotate_left (tree, parent);
+				sibling = parent->right;
+			}
+			if (!is_red (sibling->left) && !is_red (sibling->right)) {
+				sibling->red = true;
+				e = parent;
+				parent = e->parent;
+				continue;
+			}
+			if (!is_red (sibling->right)) {
+				sibling->left->red = false;
+				sibling->red = true;
+				rotate_right (tree, sibling);
+				sibling = parent->right;
+			}
+			sibling->red = parent->red;
+			parent->red = false;
+			sibling->right->red = false;
+			rotate_left (tree, parent);
+		} else {
+			struct rb_elem *sibling = parent->left;
+			if (is_red (sibling)) {
+				sibling->red = false;
+				parent->red = true;
+				rotate_right (tree, parent);
+				sibling = parent->left;
+			}
+			if (!is_red (sibling->left) && !is_red (sibling->right)) {
+				sibling->red = true;
+				e = parent;
+				parent = e->parent;
+				continue;
+			}
+			if (!is_red (sibling->left)) {
+				sibling->right->red = false;
+				sibling->red = true;
+				rotate_left (tree, sibling);
+				sibling = parent->left;
+			}
+			sibling->red = parent->red;
+			parent->red = false;
+			sibling->left->red = false;
+			rotate_right (tree, parent);
+		}
+		e = tree->root;
+	}
+	if (e != NULL)
+		e->red = false;
+}
@@ -194,3 +194,41 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+cpu_quota (int quota, int period) {
+	return syscall2 (SYS_CPU_QUOTA, quota, period);
+}
+
+int
+futex (int *uaddr, int op, int val, int *uaddr2, int val2) {
+	return syscall5 (SYS_FUTEX, uaddr, op, val, uaddr2, val2);
+}
+
+/* Where threads started by thread_create() begin: runs FUNC and
+   exits the thread with its return value. */
+static void
+thread_entry (thread_func *func, void *aux) {
+	thread_exit (func (aux));
+}
+
+tid_t
+thread_create (thread_func *func, void *aux) {
+	return syscall3 (SYS_THREAD_CREATE, thread_entry, func, aux);
+}
+
+int
+thread_join (tid_t tid) {
+	return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+int
+thread_detach (tid_t tid) {
+	return syscall1 (SYS_THREAD_DETACH, tid);
+}
+
+void
+thread_exit (int status) {
+	syscall1 (SYS_THREAD_EXIT, status);
+	NOT_REACHED ();
+}
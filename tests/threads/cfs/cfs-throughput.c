@@ -0,0 +1,81 @@
+/* Checks that the completely fair scheduler keeps the CPU busy
+   and shares it evenly among CPU-bound threads.
+
+   THREAD_CNT threads of nice 0 each spin until they have seen
+   WORK_TICKS timer ticks while running.  The whole batch should
+   take about THREAD_CNT * WORK_TICKS ticks, since no time is lost
+   to idling or to switching.  Since every thread runs at the same
+   rate, none should finish much before the others. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8
+#define WORK_TICKS 200
+
+struct work_info 
+  {
+    int64_t end_time;
+    struct semaphore *done;
+  };
+
+static thread_func work_thread;
+
+void
+test_cfs_throughput (void) 
+{
+  struct work_info info[THREAD_CNT];
+  struct semaphore done;
+  int64_t start_time, first_end;
+  int i;
+
+  ASSERT (thread_cfs);
+
+  thread_set_nice (-20);
+  sema_init (&done, 0);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+
+      info[i].done = &done;
+      snprintf (name, sizeof name, "work %d", i);
+      thread_create (name, PRI_DEFAULT, work_thread, &info[i]);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  first_end = info[0].end_time;
+  for (i = 1; i < THREAD_CNT; i++)
+    if (info[i].end_time < first_end)
+      first_end = info[i].end_time;
+
+  msg ("%d threads ran %d ticks each.", THREAD_CNT, WORK_TICKS);
+  msg ("The batch took %"PRId64" ticks.", timer_elapsed (start_time));
+  msg ("The first thread finished after %"PRId64" ticks.",
+       first_end - start_time);
+}
+
+static void
+work_thread (void *info_) 
+{
+  struct work_info *info = info_;
+  int64_t last_time = timer_ticks ();
+  int tick_count = 0;
+
+  while (tick_count < WORK_TICKS) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        tick_count++;
+      last_time = cur_time;
+    }
+  info->end_time = timer_ticks ();
+  sema_up (info->done);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($ideal) = 8 * 200;
+my ($batch, $first);
+foreach (@output) {
+    $batch = $1 if /^\(cfs-throughput\) The batch took (\d+) ticks\.$/;
+    $first = $1
+      if /^\(cfs-throughput\) The first thread finished after (\d+) ticks\.$/;
+}
+fail "missing batch time\n" if !defined $batch;
+fail "missing first finish time\n" if !defined $first;
+
+# The batch should take about as long as the work it contains, and
+# with an even share of the CPU every thread should finish close to
+# the end of it.
+fail "batch took $batch ticks, more than 10% over the ideal $ideal\n"
+  if $batch > $ideal * 1.1;
+fail "first thread finished after $first of $batch ticks\n"
+  if $first < $batch * 0.9;
+pass;
@@ -0,0 +1,91 @@
+/* Checks CPU bandwidth control.  A "capped" thread limits itself
+   to 2 ticks of CPU in every 10, then creates a child, which
+   shares the limit.  Both spin next to a "free" thread of the same
+   priority for about a second.  The capped pair should get about
+   20% of the CPU between them, and the free thread the rest. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define RUN_TICKS 100
+
+static thread_func free_thread;
+static thread_func capped_thread;
+static thread_func capped_child_thread;
+
+static struct semaphore done;
+static int64_t start_time;
+static int free_ticks;
+static int capped_ticks[2];
+
+void
+test_cpu_quota (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  start_time = timer_ticks ();
+  thread_create ("free", PRI_DEFAULT, free_thread, NULL);
+  thread_create ("capped", PRI_DEFAULT, capped_thread, NULL);
+  for (i = 0; i < 3; i++)
+    sema_down (&done);
+
+  if (capped_ticks[0] + capped_ticks[1] > RUN_TICKS * 35 / 100)
+    fail ("capped threads ran for %d of %d ticks",
+          capped_ticks[0] + capped_ticks[1], RUN_TICKS);
+  msg ("Capped threads got at most 35%% of the CPU.");
+  if (free_ticks < RUN_TICKS * 55 / 100)
+    fail ("free thread ran for only %d of %d ticks", free_ticks, RUN_TICKS);
+  msg ("Free thread got at least 55%% of the CPU.");
+}
+
+/* Counts the ticks seen while running, into *TICKS, until
+   RUN_TICKS have passed since the start of the test. */
+static void
+spin (int *ticks) 
+{
+  int64_t last_time = timer_ticks ();
+
+  while (timer_elapsed (start_time) < RUN_TICKS) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        (*ticks)++;
+      last_time = cur_time;
+    }
+  sema_up (&done);
+}
+
+static void
+free_thread (void *aux UNUSED) 
+{
+  spin (&free_ticks);
+}
+
+static void
+capped_thread (void *aux UNUSED) 
+{
+  if (thread_set_cpu_quota (0, 10) != -1
+      || thread_set_cpu_quota (20, 10) != -1
+      || thread_set_cpu_quota (5, 0) != -1)
+    fail ("invalid quota accepted");
+  msg ("Invalid quotas rejected.");
+
+  if (thread_set_cpu_quota (2, 10) != 0)
+    fail ("quota of 2 ticks per 10 rejected");
+  thread_create ("capped child", PRI_DEFAULT, capped_child_thread, NULL);
+  spin (&capped_ticks[0]);
+}
+
+static void
+capped_child_thread (void *aux UNUSED) 
+{
+  spin (&capped_ticks[1]);
+}
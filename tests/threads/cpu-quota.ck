@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cpu-quota) begin
+(cpu-quota) Invalid quotas rejected.
+(cpu-quota) Capped threads got at most 35% of the CPU.
+(cpu-quota) Free thread got at least 55% of the CPU.
+(cpu-quota) end
+EOF
+pass;
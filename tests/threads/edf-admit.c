@@ -0,0 +1,67 @@
+/* Checks admission control of deadline threads.  Threads whose
+   parameters make no sense are refused, and so is any thread
+   that would take the total utilization of deadline threads over
+   95%.  The share of a thread that exits can be given out
+   again. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func wait_thread;
+
+static struct semaphore go;
+static struct semaphore done;
+
+void
+test_edf_admit (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&go, 0);
+  sema_init (&done, 0);
+
+  if (thread_create_deadline ("bad", 0, 10, 10, wait_thread, NULL) != TID_ERROR
+      || thread_create_deadline ("bad", 5, 10, 4, wait_thread, NULL) != TID_ERROR
+      || thread_create_deadline ("bad", 4, 10, 20, wait_thread, NULL) != TID_ERROR)
+    fail ("invalid parameters were admitted");
+  msg ("Invalid parameters rejected.");
+
+  if (thread_create_deadline ("dl 1", 4, 10, 10, wait_thread, NULL) == TID_ERROR
+      || thread_create_deadline ("dl 2", 2, 10, 5, wait_thread, NULL) == TID_ERROR)
+    fail ("40%% and 40%% were not admitted");
+  msg ("Admitted 40%% and 40%%.");
+
+  if (thread_create_deadline ("dl 3", 2, 10, 10, wait_thread, NULL) != TID_ERROR)
+    fail ("20%% more was admitted");
+  msg ("20%% more rejected.");
+
+  if (thread_create_deadline ("dl 3", 1, 10, 10, wait_thread, NULL) == TID_ERROR)
+    fail ("10%% more was not admitted");
+  msg ("10%% more admitted.");
+
+  /* Let the three threads exit.  They run ahead of us, so they
+     are gone by the time we are back. */
+  sema_up (&go);
+  sema_up (&go);
+  sema_up (&go);
+  sema_down (&done);
+  sema_down (&done);
+  sema_down (&done);
+
+  if (thread_create_deadline ("dl 4", 8, 10, 10, wait_thread, NULL) == TID_ERROR)
+    fail ("80%% was not admitted after the others exited");
+  msg ("After they exited, 80%% admitted.");
+  sema_up (&go);
+  sema_down (&done);
+}
+
+static void
+wait_thread (void *aux UNUSED) 
+{
+  sema_down (&go);
+  sema_up (&done);
+}
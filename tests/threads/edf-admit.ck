@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) Invalid parameters rejected.
+(edf-admit) Admitted 40% and 40%.
+(edf-admit) 20% more rejected.
+(edf-admit) 10% more admitted.
+(edf-admit) After they exited, 80% admitted.
+(edf-admit) end
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* Runs a periodic deadline thread whose every job needs exactly
+   its budget of CPU, next to a CPU-bound thread of the highest
+   priority.  Using the whole budget is not an overrun, so the
+   thread is never throttled and misses no deadline. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define JOB_CNT 10
+
+static thread_func dl_thread;
+static thread_func hog_thread;
+
+static struct semaphore done;
+static unsigned misses;
+
+void
+test_edf_exact (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  if (thread_create_deadline ("dl", 3, 10, 10, dl_thread, NULL) == TID_ERROR)
+    fail ("dl was not admitted");
+  thread_create ("hog", PRI_MAX, hog_thread, NULL);
+
+  sema_down (&done);
+  sema_down (&done);
+
+  msg ("dl ran %d jobs with %u deadline misses.", JOB_CNT, misses);
+}
+
+/* Spins for WORK ticks. */
+static void
+spin (int work) 
+{
+  int64_t last_time = timer_ticks ();
+
+  while (work > 0) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        work--;
+      last_time = cur_time;
+    }
+}
+
+static void
+dl_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < JOB_CNT; i++) 
+    {
+      /* Spin for 3 ticks, with a budget of 3. */
+      spin (3);
+      thread_wait_next_period ();
+    }
+  misses = thread_deadline_misses ();
+  sema_up (&done);
+}
+
+static void
+hog_thread (void *aux UNUSED) 
+{
+  spin (150);
+  sema_up (&done);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-exact) begin
+(edf-exact) dl ran 10 jobs with 0 deadline misses.
+(edf-exact) end
+EOF
+pass;
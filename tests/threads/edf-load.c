@@ -0,0 +1,94 @@
+/* Runs two periodic deadline threads next to a CPU-bound thread
+   of the highest priority.  Deadline threads run ahead of every
+   priority, and the two together need less than half of the CPU,
+   so neither should miss a single deadline, even though every job
+   uses up its whole budget. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct dl_info 
+  {
+    const char *name;
+    int64_t runtime, period;   /* Parameters, in ticks. */
+    int work;                  /* Ticks of work per job. */
+    int jobs;                  /* Number of jobs to run. */
+    unsigned misses;           /* Deadline misses at the end. */
+    struct semaphore *done;
+  };
+
+static thread_func dl_thread;
+static thread_func hog_thread;
+
+void
+test_edf_load (void) 
+{
+  struct dl_info info[2] = {
+    {"dl 0", 2, 10, 2, 20, 0, NULL},
+    {"dl 1", 3, 15, 3, 14, 0, NULL},
+  };
+  struct semaphore done;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  for (i = 0; i < 2; i++) 
+    {
+      info[i].done = &done;
+      if (thread_create_deadline (info[i].name, info[i].runtime,
+                                  info[i].period, info[i].period,
+                                  dl_thread, &info[i]) == TID_ERROR)
+        fail ("%s was not admitted", info[i].name);
+    }
+  thread_create ("hog", PRI_MAX, hog_thread, &done);
+
+  for (i = 0; i < 3; i++)
+    sema_down (&done);
+
+  for (i = 0; i < 2; i++)
+    msg ("%s ran %d jobs with %u deadline misses.",
+         info[i].name, info[i].jobs, info[i].misses);
+}
+
+/* Spins for WORK ticks. */
+static void
+spin (int work) 
+{
+  int64_t last_time = timer_ticks ();
+
+  while (work > 0) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        work--;
+      last_time = cur_time;
+    }
+}
+
+static void
+dl_thread (void *info_) 
+{
+  struct dl_info *info = info_;
+  int i;
+
+  for (i = 0; i < info->jobs; i++) 
+    {
+      spin (info->work);
+      thread_wait_next_period ();
+    }
+  info->misses = thread_deadline_misses ();
+  sema_up (info->done);
+}
+
+static void
+hog_thread (void *done) 
+{
+  spin (300);
+  sema_up (done);
+}
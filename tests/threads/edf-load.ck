@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-load) begin
+(edf-load) dl 0 ran 20 jobs with 0 deadline misses.
+(edf-load) dl 1 ran 14 jobs with 0 deadline misses.
+(edf-load) end
+EOF
+pass;
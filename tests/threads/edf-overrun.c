@@ -0,0 +1,87 @@
+/* Runs a periodic deadline thread whose every job needs more CPU
+   than its budget, next to a thread of normal priority.  The
+   deadline thread is throttled once per job, which counts as one
+   deadline miss, and finishes the job in the next period.  While
+   it is throttled, the other thread gets the CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define JOB_CNT 5
+
+static thread_func dl_thread;
+static thread_func normal_thread;
+
+static struct semaphore done;
+static unsigned misses;
+static volatile bool stop;
+static int normal_ticks;
+
+void
+test_edf_overrun (void) 
+{
+  int64_t start_time, elapsed;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  start_time = timer_ticks ();
+  thread_create ("normal", PRI_DEFAULT, normal_thread, NULL);
+  if (thread_create_deadline ("dl", 2, 10, 10, dl_thread, NULL) == TID_ERROR)
+    fail ("dl was not admitted");
+
+  sema_down (&done);
+  stop = true;
+  sema_down (&done);
+  elapsed = timer_elapsed (start_time);
+
+  msg ("dl ran %d jobs with %u deadline misses.", JOB_CNT, misses);
+  if (normal_ticks * 2 < elapsed)
+    fail ("normal thread ran for only %d of %lld ticks",
+          normal_ticks, elapsed);
+  msg ("normal thread ran for more than half of the time.");
+}
+
+static void
+dl_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < JOB_CNT; i++) 
+    {
+      /* Spin for 3 ticks, with a budget of 2. */
+      int64_t last_time = timer_ticks ();
+      int work = 3;
+
+      while (work > 0) 
+        {
+          int64_t cur_time = timer_ticks ();
+          if (cur_time != last_time)
+            work--;
+          last_time = cur_time;
+        }
+      thread_wait_next_period ();
+    }
+  misses = thread_deadline_misses ();
+  sema_up (&done);
+}
+
+static void
+normal_thread (void *aux UNUSED) 
+{
+  int64_t last_time = timer_ticks ();
+
+  while (!stop) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        normal_ticks++;
+      last_time = cur_time;
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-overrun) begin
+(edf-overrun) dl ran 5 jobs with 5 deadline misses.
+(edf-overrun) normal thread ran for more than half of the time.
+(edf-overrun) end
+EOF
+pass;
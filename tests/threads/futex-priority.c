@@ -0,0 +1,46 @@
+/* Tests that futex_wait() does not sleep on a word that no
+   longer holds the expected value, and that futex_wake() wakes
+   the threads waiting on a word highest priority first, as many
+   as asked for. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/futex.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+
+static thread_func futex_priority_thread;
+static uint32_t word;
+
+void
+test_futex_priority (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Wait on a changed word returned %d.", futex_wait (&word, 1));
+
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < 10; i++) 
+    {
+      int priority = PRI_DEFAULT - (i + 3) % 10 - 1;
+      char name[16];
+      snprintf (name, sizeof name, "priority %d", priority);
+      thread_create (name, priority, futex_priority_thread, NULL);
+    }
+
+  for (i = 0; i < 5; i++) 
+    msg ("Back in main thread, woke %d.", futex_wake (&word, 1));
+  msg ("Back in main thread, woke %d.", futex_wake (&word, 3));
+  msg ("Back in main thread, woke %d.", futex_wake (&word, 10));
+  msg ("Back in main thread, woke %d.", futex_wake (&word, 10));
+}
+
+static void
+futex_priority_thread (void *aux UNUSED) 
+{
+  if (futex_wait (&word, 0) == 0)
+    msg ("Thread %s woke up.", thread_name ());
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-priority) begin
+(futex-priority) Wait on a changed word returned -1.
+(futex-priority) Thread priority 30 woke up.
+(futex-priority) Back in main thread, woke 1.
+(futex-priority) Thread priority 29 woke up.
+(futex-priority) Back in main thread, woke 1.
+(futex-priority) Thread priority 28 woke up.
+(futex-priority) Back in main thread, woke 1.
+(futex-priority) Thread priority 27 woke up.
+(futex-priority) Back in main thread, woke 1.
+(futex-priority) Thread priority 26 woke up.
+(futex-priority) Back in main thread, woke 1.
+(futex-priority) Thread priority 25 woke up.
+(futex-priority) Thread priority 24 woke up.
+(futex-priority) Thread priority 23 woke up.
+(futex-priority) Back in main thread, woke 3.
+(futex-priority) Thread priority 22 woke up.
+(futex-priority) Thread priority 21 woke up.
+(futex-priority) Back in main thread, woke 2.
+(futex-priority) Back in main thread, woke 0.
+(futex-priority) end
+EOF
+pass;
@@ -0,0 +1,46 @@
+/* Tests futex_requeue(): one waiter on the first word is woken,
+   and the rest are moved to wait on the second word without
+   waking up.  A wake-up on the first word then finds no waiters,
+   and wake-ups on the second word wake the moved threads in
+   priority order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/futex.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+
+static thread_func futex_requeue_thread;
+static uint32_t first, second;
+
+void
+test_futex_requeue (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Each thread has a higher priority than the main thread, so
+     it runs and waits on FIRST right away. */
+  for (i = 0; i < 5; i++) 
+    {
+      int priority = PRI_DEFAULT + (i + 2) % 5 + 1;
+      char name[16];
+      snprintf (name, sizeof name, "priority %d", priority);
+      thread_create (name, priority, futex_requeue_thread, NULL);
+    }
+
+  msg ("Requeue woke or moved %d threads.",
+       futex_requeue (&first, 1, &second, 10));
+  msg ("Wake on the first word woke %d threads.", futex_wake (&first, 10));
+  msg ("Wake on the second word woke %d threads.", futex_wake (&second, 2));
+  msg ("Wake on the second word woke %d threads.", futex_wake (&second, 10));
+}
+
+static void
+futex_requeue_thread (void *aux UNUSED) 
+{
+  if (futex_wait (&first, 0) == 0)
+    msg ("Thread %s woke up.", thread_name ());
+}
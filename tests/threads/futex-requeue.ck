@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-requeue) begin
+(futex-requeue) Thread priority 36 woke up.
+(futex-requeue) Requeue woke or moved 5 threads.
+(futex-requeue) Wake on the first word woke 0 threads.
+(futex-requeue) Thread priority 35 woke up.
+(futex-requeue) Thread priority 34 woke up.
+(futex-requeue) Wake on the second word woke 2 threads.
+(futex-requeue) Thread priority 33 woke up.
+(futex-requeue) Thread priority 32 woke up.
+(futex-requeue) Wake on the second word woke 2 threads.
+(futex-requeue) end
+EOF
+pass;
@@ -0,0 +1,92 @@
+/* Measures how much memory malloc() wastes to internal
+   fragmentation, by allocating blocks of random sizes and
+   comparing the bytes asked for with the bytes each block really
+   has.  For comparison, it also works out what the old scheme of
+   power-of-2 size classes up to 1 kB, and whole pages beyond,
+   would have used for the same requests.  Then it grows and
+   shrinks blocks with realloc() and counts how many of them
+   stayed in place. */
+
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+
+#define BLOCK_CNT 500
+#define MAX_SIZE 3000
+#define RESIZE_CNT 500
+
+/* Bytes the old power-of-2 scheme gave a SIZE-byte request,
+   leaving out the header of a big block. */
+static size_t
+old_block_size (size_t size) 
+{
+  size_t block_size = 16;
+
+  if (size > 1024)
+    return (size + PGSIZE - 1) / PGSIZE * PGSIZE;
+  while (block_size < size)
+    block_size *= 2;
+  return block_size;
+}
+
+void
+test_malloc_frag (void) 
+{
+  static void *blocks[BLOCK_CNT];
+  size_t requested = 0, old_used = 0, new_used = 0;
+  int in_place = 0;
+  void *big;
+  int i;
+
+  random_init (0);
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      size_t size = random_ulong () % MAX_SIZE + 1;
+
+      blocks[i] = malloc (size);
+      if (blocks[i] == NULL)
+        fail ("malloc of %zu bytes failed", size);
+      requested += size;
+      old_used += old_block_size (size);
+      new_used += malloc_usable_size (blocks[i]);
+    }
+  msg ("%d blocks, %zu bytes requested.", BLOCK_CNT, requested);
+  msg ("Power-of-2 classes: %zu bytes, %zu%% wasted.",
+       old_used, (old_used - requested) * 100 / old_used);
+  msg ("Current classes: %zu bytes, %zu%% wasted.",
+       new_used, (new_used - requested) * 100 / new_used);
+  if (new_used > old_used)
+    fail ("current classes use more memory than power-of-2 classes");
+
+  /* Nudge each block's size up and down within its class. */
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      size_t size = malloc_usable_size (blocks[i]);
+      void *p = realloc (blocks[i], size - size / 8);
+
+      if (p == NULL)
+        fail ("realloc failed");
+      in_place += p == blocks[i];
+      blocks[i] = p;
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+
+  /* Grow a big block a page at a time. */
+  big = malloc (PGSIZE);
+  for (i = 0; i < RESIZE_CNT; i++) 
+    {
+      size_t size = PGSIZE * (2 + i % 8);
+      void *p = realloc (big, size);
+
+      if (p == NULL)
+        fail ("realloc to %zu bytes failed", size);
+      in_place += p == big;
+      big = p;
+    }
+  free (big);
+  msg ("%d of %d reallocs resized in place.",
+       in_place, BLOCK_CNT + RESIZE_CNT);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The figures depend on the memory layout, so only the shape of
+# the report is checked.
+fail "missing \"begin\" message\n"
+  if !grep ($_ eq '(malloc-frag) begin', @output);
+fail "missing request total\n"
+  if !grep (/^\(malloc-frag\) 500 blocks, \d+ bytes requested\.$/, @output);
+fail "missing power-of-2 report\n"
+  if !grep (/^\(malloc-frag\) Power-of-2 classes: \d+ bytes, \d+% wasted\.$/,
+	    @output);
+fail "missing current report\n"
+  if !grep (/^\(malloc-frag\) Current classes: \d+ bytes, \d+% wasted\.$/,
+	    @output);
+fail "missing realloc report\n"
+  if !grep (/^\(malloc-frag\) \d+ of 1000 reallocs resized in place\.$/,
+	    @output);
+fail "missing \"end\" message\n"
+  if !grep ($_ eq '(malloc-frag) end', @output);
+pass;
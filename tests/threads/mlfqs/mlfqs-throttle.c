@@ -0,0 +1,102 @@
+/* Checks that recent_cpu is kept up to date for threads that are
+   throttled for longer than the scheduler keeps decay history.
+
+   A "capped" thread limits itself to 1 tick of CPU every 70
+   seconds, and a deadline thread gets a budget of 1 tick in a
+   period of 70 seconds.  Both set their nice value to 20, then
+   spin for 2 ticks, which uses up their runtime and throttles them
+   until the next period.  While they are throttled nothing runs,
+   so load_avg stays near 0, and every once-per-second decay
+   brings recent_cpu close to nice.  When they run again, their
+   recent_cpu should be about 20, plus the ticks run since. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THROTTLE_SECONDS 70
+
+static thread_func capped_thread;
+static thread_func dl_thread;
+
+static struct semaphore done;
+static int64_t throttled_ticks[2];
+static int recent_cpu[2];
+
+void
+test_mlfqs_throttle (void) 
+{
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&done, 0);
+  msg ("Throttling two threads for %d seconds...", THROTTLE_SECONDS);
+  thread_create ("capped", PRI_DEFAULT, capped_thread, NULL);
+  if (thread_create_deadline ("dl", 1, THROTTLE_SECONDS * TIMER_FREQ,
+                              THROTTLE_SECONDS * TIMER_FREQ,
+                              dl_thread, NULL) == TID_ERROR)
+    fail ("dl was not admitted");
+  for (i = 0; i < 2; i++)
+    sema_down (&done);
+
+  for (i = 0; i < 2; i++) 
+    {
+      const char *name = i == 0 ? "Capped" : "Deadline";
+
+      if (throttled_ticks[i] < (THROTTLE_SECONDS - 1) * TIMER_FREQ)
+        fail ("%s thread was throttled for only %lld ticks",
+              name, throttled_ticks[i]);
+      if (recent_cpu[i] < 2000 || recent_cpu[i] >= 2400)
+        fail ("%s thread has recent_cpu %d.%02d after the throttle",
+              name, recent_cpu[i] / 100, recent_cpu[i] % 100);
+      msg ("%s thread was throttled and its recent_cpu decayed.", name);
+    }
+}
+
+/* Spins until 2 ticks of CPU time have been seen, and returns the
+   longest gap between two ticks, which is the time spent
+   throttled. */
+static int64_t
+spin (void) 
+{
+  int64_t last_time = timer_ticks ();
+  int64_t longest = 0;
+  int work = 2;
+
+  while (work > 0) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time) 
+        {
+          if (cur_time - last_time > longest)
+            longest = cur_time - last_time;
+          work--;
+        }
+      last_time = cur_time;
+    }
+  return longest;
+}
+
+static void
+capped_thread (void *aux UNUSED) 
+{
+  thread_set_nice (20);
+  if (thread_set_cpu_quota (1, THROTTLE_SECONDS * TIMER_FREQ) != 0)
+    fail ("quota of 1 tick per %d seconds rejected", THROTTLE_SECONDS);
+  throttled_ticks[0] = spin ();
+  recent_cpu[0] = thread_get_recent_cpu ();
+  sema_up (&done);
+}
+
+static void
+dl_thread (void *aux UNUSED) 
+{
+  thread_set_nice (20);
+  throttled_ticks[1] = spin ();
+  recent_cpu[1] = thread_get_recent_cpu ();
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-throttle) begin
+(mlfqs-throttle) Throttling two threads for 70 seconds...
+(mlfqs-throttle) Capped thread was throttled and its recent_cpu decayed.
+(mlfqs-throttle) Deadline thread was throttled and its recent_cpu decayed.
+(mlfqs-throttle) end
+EOF
+pass;
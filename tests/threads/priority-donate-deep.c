@@ -0,0 +1,85 @@
+/* The main thread sets its priority to PRI_MIN, acquires lock 0
+   and creates threads 1..DEPTH-1 with priorities PRI_MIN + 2,
+   4, 6, ...  Thread[i] acquires lock[i] (unless it is the last
+   thread) and then blocks on lock[i-1], so the threads form a
+   single chain of DEPTH - 1 lock holders ending at the main
+   thread.  Each new thread must raise the priority of every
+   holder down the chain, however long it is.
+
+   Then the main thread releases lock 0, and the chain unwinds
+   from the top: each thread should finish at its own priority
+   once it has released both of its locks. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define DEPTH 24
+
+struct lock_pair
+  {
+    struct lock *second;
+    struct lock *first;
+  };
+
+static thread_func donor_thread_func;
+
+void
+test_priority_donate_deep (void) 
+{
+  int i;  
+  struct lock locks[DEPTH - 1];
+  struct lock_pair lock_pairs[DEPTH];
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+
+  for (i = 0; i < DEPTH - 1; i++)
+    lock_init (&locks[i]);
+
+  lock_acquire (&locks[0]);
+  msg ("%s got lock.", thread_name ());
+
+  for (i = 1; i < DEPTH; i++)
+    {
+      char name[16];
+      int thread_priority;
+
+      snprintf (name, sizeof name, "thread %d", i);
+      thread_priority = PRI_MIN + i * 2;
+      lock_pairs[i].first = i < DEPTH - 1 ? locks + i: NULL;
+      lock_pairs[i].second = locks + i - 1;
+
+      thread_create (name, thread_priority, donor_thread_func, lock_pairs + i);
+      msg ("%s should have priority %d.  Actual priority: %d.",
+          thread_name (), thread_priority, thread_get_priority ());
+    }
+
+  lock_release (&locks[0]);
+  msg ("%s finishing with priority %d.", thread_name (),
+                                         thread_get_priority ());
+}
+
+static void
+donor_thread_func (void *locks_) 
+{
+  struct lock_pair *locks = locks_;
+
+  if (locks->first)
+    lock_acquire (locks->first);
+
+  lock_acquire (locks->second);
+  lock_release (locks->second);
+
+  if (locks->first)
+    lock_release (locks->first);
+
+  msg ("%s finishing with priority %d.", thread_name (),
+                                         thread_get_priority ());
+}
+
+// vim: sw=2
@@ -0,0 +1,69 @@
+/* The main thread and a "reader" thread both acquire an rwlock
+   for reading.  Then a higher-priority "writer" thread blocks
+   acquiring the rwlock for writing, which should donate its
+   priority to both readers.  The main thread checks its own
+   priority, and the reader checks its own once it is allowed to
+   continue.  When the last reader releases the rwlock, the writer
+   must get it right away. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_and_sema
+  {
+    struct rwlock rwlock;
+    struct semaphore go;
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_priority_donate_rwlock_read (void) 
+{
+  struct rwlock_and_sema ls;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&ls.rwlock);
+  sema_init (&ls.go, 0);
+  rwlock_read_acquire (&ls.rwlock);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &ls);
+  thread_create ("writer", PRI_DEFAULT + 10, writer_thread_func, &ls);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+  rwlock_read_release (&ls.rwlock);
+  sema_up (&ls.go);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *ls_) 
+{
+  struct rwlock_and_sema *ls = ls_;
+
+  rwlock_read_acquire (&ls->rwlock);
+  sema_down (&ls->go);
+  msg ("reader should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+  rwlock_read_release (&ls->rwlock);
+  msg ("reader finishing with priority %d.", thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *ls_) 
+{
+  struct rwlock_and_sema *ls = ls_;
+
+  rwlock_write_acquire (&ls->rwlock);
+  msg ("writer got the lock for writing.");
+  rwlock_write_release (&ls->rwlock);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock-read) begin
+(priority-donate-rwlock-read) Main thread should have priority 41.  Actual priority: 41.
+(priority-donate-rwlock-read) reader should have priority 41.  Actual priority: 41.
+(priority-donate-rwlock-read) writer got the lock for writing.
+(priority-donate-rwlock-read) reader finishing with priority 32.
+(priority-donate-rwlock-read) Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock-read) end
+EOF
+pass;
@@ -0,0 +1,81 @@
+/* The main thread and a lower-priority "reader" thread both
+   acquire an rwlock for reading.  The main thread cannot upgrade
+   its hold without waiting, so it waits to upgrade, which should
+   donate its priority to the reader.  Once the reader releases
+   the rwlock, the main thread holds it for writing.
+
+   Then a higher-priority "reader 2" blocks on the rwlock and
+   donates to the main thread, which downgrades its hold to
+   reading.  That must let reader 2 in at once. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_and_sema
+  {
+    struct rwlock rwlock;
+    struct semaphore ready;
+  };
+
+static thread_func reader_thread_func;
+static thread_func reader2_thread_func;
+
+void
+test_priority_donate_rwlock_upgrade (void) 
+{
+  struct rwlock_and_sema ls;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&ls.rwlock);
+  sema_init (&ls.ready, 0);
+  rwlock_read_acquire (&ls.rwlock);
+  thread_create ("reader", PRI_DEFAULT - 10, reader_thread_func, &ls);
+  sema_down (&ls.ready);
+
+  if (!rwlock_try_upgrade (&ls.rwlock))
+    msg ("Main thread must wait to upgrade.");
+  else
+    fail ("Main thread upgraded while another thread was reading.");
+  if (!rwlock_upgrade (&ls.rwlock))
+    fail ("Main thread could not wait to upgrade.");
+  msg ("Main thread upgraded its hold to writing.");
+
+  thread_create ("reader 2", PRI_DEFAULT + 5, reader2_thread_func,
+                 &ls.rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  rwlock_downgrade (&ls.rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+  rwlock_read_release (&ls.rwlock);
+}
+
+static void
+reader_thread_func (void *ls_) 
+{
+  struct rwlock_and_sema *ls = ls_;
+
+  rwlock_read_acquire (&ls->rwlock);
+  sema_up (&ls->ready);
+  msg ("reader should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+  rwlock_read_release (&ls->rwlock);
+}
+
+static void
+reader2_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_read_acquire (rwlock);
+  msg ("reader 2 got the lock for reading.");
+  rwlock_read_release (rwlock);
+}
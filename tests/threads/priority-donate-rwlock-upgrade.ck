@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock-upgrade) begin
+(priority-donate-rwlock-upgrade) Main thread must wait to upgrade.
+(priority-donate-rwlock-upgrade) reader should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock-upgrade) Main thread upgraded its hold to writing.
+(priority-donate-rwlock-upgrade) Main thread should have priority 36.  Actual priority: 36.
+(priority-donate-rwlock-upgrade) reader 2 got the lock for reading.
+(priority-donate-rwlock-upgrade) Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock-upgrade) end
+EOF
+pass;
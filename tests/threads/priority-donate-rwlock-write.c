@@ -0,0 +1,71 @@
+/* The main thread acquires an rwlock for writing.  Then it
+   creates, in order, reader 1, a higher-priority writer and an
+   even higher-priority reader 2, all of which block on the rwlock
+   and donate their priorities to the main thread.  The readers
+   first check that they cannot get in without waiting.
+
+   When the main thread releases the rwlock, reader 2 must get it
+   first.  Reader 1 must not join it, because the writer is
+   waiting ahead of reader 1, so the writer comes next and
+   reader 1 last. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_priority_donate_rwlock_write (void) 
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_write_acquire (&rwlock);
+  thread_create ("reader 1", PRI_DEFAULT + 1, reader_thread_func, &rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("writer", PRI_DEFAULT + 3, writer_thread_func, &rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+  thread_create ("reader 2", PRI_DEFAULT + 4, reader_thread_func, &rwlock);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 4, thread_get_priority ());
+  rwlock_write_release (&rwlock);
+  msg ("Readers and writer must already have finished.");
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  if (!rwlock_try_read_acquire (rwlock))
+    msg ("%s must wait.", thread_name ());
+  else
+    fail ("%s got the lock while it was held for writing.", thread_name ());
+  rwlock_read_acquire (rwlock);
+  msg ("%s got the lock for reading.", thread_name ());
+  rwlock_read_release (rwlock);
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_write_acquire (rwlock);
+  msg ("writer got the lock for writing.");
+  rwlock_write_release (rwlock);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock-write) begin
+(priority-donate-rwlock-write) reader 1 must wait.
+(priority-donate-rwlock-write) Main thread should have priority 32.  Actual priority: 32.
+(priority-donate-rwlock-write) Main thread should have priority 34.  Actual priority: 34.
+(priority-donate-rwlock-write) reader 2 must wait.
+(priority-donate-rwlock-write) Main thread should have priority 35.  Actual priority: 35.
+(priority-donate-rwlock-write) reader 2 got the lock for reading.
+(priority-donate-rwlock-write) writer got the lock for writing.
+(priority-donate-rwlock-write) reader 1 got the lock for reading.
+(priority-donate-rwlock-write) Readers and writer must already have finished.
+(priority-donate-rwlock-write) Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock-write) end
+EOF
+pass;
@@ -0,0 +1,83 @@
+/* The main thread and a "reader 1" thread both acquire an rwlock
+   for reading.  Then a writer blocks on the rwlock, followed by
+   a higher-priority "reader 2".
+
+   When the main thread releases its hold, reader 1 still holds
+   the rwlock.  Reader 2 must not join reader 1, even though it
+   has a higher priority than the writer: otherwise a stream of
+   such readers, each one overlapping the last, would keep the
+   writer out forever.  Reader 2 gets in only once reader 1 has
+   released the rwlock, and the writer right after reader 2. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_and_sema
+  {
+    struct rwlock rwlock;
+    struct semaphore go;
+  };
+
+static thread_func reader_1_thread_func;
+static thread_func reader_2_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_writer_starve (void) 
+{
+  struct rwlock_and_sema ls;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&ls.rwlock);
+  sema_init (&ls.go, 0);
+  rwlock_read_acquire (&ls.rwlock);
+  thread_create ("reader 1", PRI_DEFAULT + 1, reader_1_thread_func, &ls);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &ls);
+  thread_create ("reader 2", PRI_DEFAULT + 3, reader_2_thread_func, &ls);
+
+  msg ("Main thread releasing its hold.");
+  rwlock_read_release (&ls.rwlock);
+  msg ("Reader 2 must still be waiting.");
+  sema_up (&ls.go);
+  msg ("Reader 2 and writer must already have finished.");
+}
+
+static void
+reader_1_thread_func (void *ls_) 
+{
+  struct rwlock_and_sema *ls = ls_;
+
+  rwlock_read_acquire (&ls->rwlock);
+  msg ("reader 1 got the lock for reading.");
+  sema_down (&ls->go);
+  msg ("reader 1 releasing its hold.");
+  rwlock_read_release (&ls->rwlock);
+}
+
+static void
+reader_2_thread_func (void *ls_) 
+{
+  struct rwlock_and_sema *ls = ls_;
+
+  rwlock_read_acquire (&ls->rwlock);
+  msg ("reader 2 got the lock for reading.");
+  rwlock_read_release (&ls->rwlock);
+}
+
+static void
+writer_thread_func (void *ls_) 
+{
+  struct rwlock_and_sema *ls = ls_;
+
+  rwlock_write_acquire (&ls->rwlock);
+  msg ("writer got the lock for writing.");
+  rwlock_write_release (&ls->rwlock);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-starve) begin
+(rwlock-writer-starve) reader 1 got the lock for reading.
+(rwlock-writer-starve) Main thread releasing its hold.
+(rwlock-writer-starve) Reader 2 must still be waiting.
+(rwlock-writer-starve) reader 1 releasing its hold.
+(rwlock-writer-starve) reader 2 got the lock for reading.
+(rwlock-writer-starve) writer got the lock for writing.
+(rwlock-writer-starve) Reader 2 and writer must already have finished.
+(rwlock-writer-starve) end
+EOF
+pass;
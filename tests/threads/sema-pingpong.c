@@ -0,0 +1,84 @@
+/* Measures the latency of a context switch.  The main thread and
+   a "pong" thread of the same priority hand control back and
+   forth through a pair of semaphores, as in sema_self_test(), so
+   each round trip is two kernel-to-kernel thread switches.
+   Checks that the two threads strictly take turns, and reports
+   the average cost of one switch, including the semaphore
+   operations around it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ROUND_TRIPS 10000
+
+static thread_func pong_thread_func;
+
+/* Number of times the pong thread has run its turn. */
+static int pong_cnt;
+
+void
+test_sema_pingpong (void) 
+{
+  struct semaphore sema[2];
+  uint64_t cycles;
+  int64_t ns;
+  int out_of_turn = -1;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  pong_cnt = 0;
+  sema_init (&sema[0], 0);
+  sema_init (&sema[1], 0);
+  thread_create ("pong", thread_get_priority (), pong_thread_func, sema);
+
+  /* Warm up, so that the pong thread has been launched once and
+     every later switch takes the regular path. */
+  sema_up (&sema[0]);
+  sema_down (&sema[1]);
+  if (pong_cnt != 1)
+    fail ("pong ran %d times during warm-up, not once", pong_cnt);
+
+  ns = timer_ns ();
+  cycles = timer_cycles ();
+  for (i = 0; i < ROUND_TRIPS; i++)
+    {
+      sema_up (&sema[0]);
+      sema_down (&sema[1]);
+      if (pong_cnt != i + 2 && out_of_turn < 0)
+        out_of_turn = i;
+    }
+  cycles = timer_cycles () - cycles;
+  ns = timer_ns () - ns;
+
+  /* Each sema_down() above must return after exactly one more
+     turn of the pong thread. */
+  if (out_of_turn >= 0)
+    fail ("pong ran out of turn in round trip %d", out_of_turn);
+  if (pong_cnt != ROUND_TRIPS + 1)
+    fail ("pong ran %d times, not %d", pong_cnt, ROUND_TRIPS + 1);
+
+  msg ("%d round trips, %d context switches.", ROUND_TRIPS, 2 * ROUND_TRIPS);
+  msg ("%lld ns per switch, %llu cycles per switch.",
+       ns / (2 * ROUND_TRIPS), cycles / (2 * ROUND_TRIPS));
+}
+
+static void
+pong_thread_func (void *sema_) 
+{
+  struct semaphore *sema = sema_;
+  int i;
+
+  for (i = 0; i <= ROUND_TRIPS; i++)
+    {
+      sema_down (&sema[0]);
+      pong_cnt++;
+      sema_up (&sema[1]);
+    }
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The latency depends on the machine, so the numbers in the
+# latency report are masked out before the comparison.
+s/^\(sema-pingpong\) \d+ ns per switch, \d+ cycles per switch\.$/(sema-pingpong) N ns per switch, N cycles per switch./
+  foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(sema-pingpong) begin
+(sema-pingpong) 10000 round trips, 20000 context switches.
+(sema-pingpong) N ns per switch, N cycles per switch.
+(sema-pingpong) end
+EOF
+pass;
@@ -25,6 +25,22 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-deep", test_priority_donate_deep},
+    {"priority-donate-rwlock-read", test_priority_donate_rwlock_read},
+    {"priority-donate-rwlock-write", test_priority_donate_rwlock_write},
+    {"priority-donate-rwlock-upgrade", test_priority_donate_rwlock_upgrade},
+    {"rwlock-writer-starve", test_rwlock_writer_starve},
+    {"sema-pingpong", test_sema_pingpong},
+    {"workqueue", test_workqueue},
+    {"thread-churn", test_thread_churn},
+    {"malloc-frag", test_malloc_frag},
+    {"edf-admit", test_edf_admit},
+    {"edf-load", test_edf_load},
+    {"edf-exact", test_edf_exact},
+    {"edf-overrun", test_edf_overrun},
+    {"cpu-quota", test_cpu_quota},
+    {"futex-priority", test_futex_priority},
+    {"futex-requeue", test_futex_requeue},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +54,12 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-throttle", test_mlfqs_throttle},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
+    {"cfs-throughput", test_cfs_throughput},
   };
 
 static const char *test_name;
@@ -19,6 +19,22 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_deep;
+extern test_func test_priority_donate_rwlock_read;
+extern test_func test_priority_donate_rwlock_write;
+extern test_func test_priority_donate_rwlock_upgrade;
+extern test_func test_rwlock_writer_starve;
+extern test_func test_sema_pingpong;
+extern test_func test_workqueue;
+extern test_func test_thread_churn;
+extern test_func test_malloc_frag;
+extern test_func test_edf_admit;
+extern test_func test_edf_load;
+extern test_func test_edf_exact;
+extern test_func test_edf_overrun;
+extern test_func test_cpu_quota;
+extern test_func test_futex_priority;
+extern test_func test_futex_requeue;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,6 +48,12 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_throttle;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
+extern test_func test_cfs_throughput;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
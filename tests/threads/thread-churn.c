@@ -0,0 +1,48 @@
+/* Measures the cost of creating a thread and reaping it.  The
+   main thread creates threads of higher priority that exit right
+   away, so each one runs and dies before thread_create() returns
+   and the next one can reuse its page. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 1000
+
+static thread_func exit_thread_func;
+
+void
+test_thread_churn (void) 
+{
+  int exited = 0;
+  uint64_t cycles;
+  int64_t ns;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  ns = timer_ns ();
+  cycles = timer_cycles ();
+  for (i = 0; i < THREAD_CNT; i++)
+    if (thread_create ("churn", thread_get_priority () + 1,
+                       exit_thread_func, &exited) == TID_ERROR)
+      fail ("thread_create failed after %d threads", i);
+  cycles = timer_cycles () - cycles;
+  ns = timer_ns () - ns;
+
+  msg ("%d threads created, %d exited.", THREAD_CNT, exited);
+  msg ("%lld ns per thread, %llu cycles per thread.",
+       ns / THREAD_CNT, cycles / THREAD_CNT);
+}
+
+static void
+exit_thread_func (void *exited_) 
+{
+  int *exited = exited_;
+
+  (*exited)++;
+}
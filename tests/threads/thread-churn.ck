@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The cost depends on the machine, so only the shape of the
+# report is checked.
+fail "missing \"begin\" message\n"
+  if !grep ($_ eq '(thread-churn) begin', @output);
+fail "missing thread count\n"
+  if !grep ($_ eq '(thread-churn) 1000 threads created, 1000 exited.',
+	    @output);
+fail "missing cost report\n"
+  if !grep (/^\(thread-churn\) \d+ ns per thread, \d+ cycles per thread\.$/,
+	    @output);
+fail "missing \"end\" message\n"
+  if !grep ($_ eq '(thread-churn) end', @output);
+pass;
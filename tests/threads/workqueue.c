@@ -0,0 +1,71 @@
+/* Queues work on a workqueue from a thread and from a kernel
+   timer callback, which runs in the timer softirq, and checks
+   that the work runs in the workqueue's worker thread, at the
+   workqueue's priority, in the order it was queued. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define WORK_CNT 3
+
+static struct workqueue test_wq;
+static struct work works[WORK_CNT];
+static struct semaphore queued;
+static bool requeued;
+
+static work_func work_func_;
+static timer_func timer_func_;
+
+void
+test_workqueue (void) 
+{
+  struct timer timer;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  if (!workqueue_create (&test_wq, "test_wq", PRI_DEFAULT + 1, 1))
+    fail ("workqueue_create failed");
+  for (i = 0; i < WORK_CNT; i++)
+    work_init (&works[i], work_func_, (void *) (intptr_t) i);
+  sema_init (&queued, 0);
+
+  msg ("Queueing work 0 from thread %s.", thread_name ());
+  work_queue (&test_wq, &works[0]);
+
+  msg ("Queueing works 1 and 2 from a timer.");
+  timer_setup (&timer, timer_func_, NULL);
+  timer_arm (&timer, timer_ticks () + 1);
+  sema_down (&queued);
+
+  msg ("Queueing a pending work %s.", requeued ? "succeeded" : "was refused");
+  workqueue_flush (&test_wq);
+  msg ("Workqueue flushed.");
+}
+
+static void
+timer_func_ (void *aux UNUSED) 
+{
+  ASSERT (intr_context ());
+
+  work_queue (&test_wq, &works[1]);
+  work_queue (&test_wq, &works[2]);
+  requeued = work_queue (&test_wq, &works[1]);
+  sema_up (&queued);
+}
+
+static void
+work_func_ (void *aux) 
+{
+  int i = (intptr_t) aux;
+
+  msg ("Work %d ran in %s at priority %d.",
+       i, thread_name (), thread_get_priority ());
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Queueing work 0 from thread main.
+(workqueue) Work 0 ran in test_wq at priority 32.
+(workqueue) Queueing works 1 and 2 from a timer.
+(workqueue) Work 1 ran in test_wq at priority 32.
+(workqueue) Work 2 ran in test_wq at priority 32.
+(workqueue) Queueing a pending work was refused.
+(workqueue) Workqueue flushed.
+(workqueue) end
+EOF
+pass;
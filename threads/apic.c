@@ -0,0 +1,317 @@
+#include "threads/apic.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "intrinsic.h"
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* The local APIC.  Every CPU has one at the same physical
+   address; each CPU only ever sees its own through it.  The
+   registers are memory mapped, so we map them uncached into the
+   kernel address space and access them with 32-bit loads and
+   stores.  See [IA32-v3a] chapter 10 "Advanced Programmable
+   Interrupt Controller (APIC)". */
+
+/* IA32_APIC_BASE model-specific register. */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_ENABLE (1 << 11)      /* Global enable. */
+
+/* CPUID.01H:EDX bit reporting an on-chip APIC. */
+#define CPUID_APIC (1 << 9)
+
+/* Spurious interrupt vector register bits. */
+#define SVR_ENABLE 0x100                /* APIC software enable. */
+
+/* Interrupt command register bits. */
+#define ICR_INIT         0x00000500     /* INIT delivery mode. */
+#define ICR_STARTUP      0x00000600     /* Start-up delivery mode. */
+#define ICR_PENDING      0x00001000     /* Delivery status. */
+#define ICR_ASSERT       0x00004000     /* Level assert. */
+#define ICR_ALL_BUT_SELF 0x000c0000     /* Destination shorthand. */
+
+/* Kernel virtual address of the register page, or NULL if the
+   local APIC has not been mapped. */
+static volatile uint8_t *lapic_base;
+
+/* The I/O APIC, which takes over from the 8259A PICs the job of
+   turning device IRQ lines into interrupt messages.  Its
+   registers are accessed indirectly: the register number is
+   written to IOREGSEL, then the register is accessed through
+   IOWIN.  See [82093AA]. */
+#define IOAPIC_DEFAULT_BASE 0xfec00000  /* Usual physical address. */
+#define IOREGSEL 0x00                   /* Register select. */
+#define IOWIN    0x10                   /* Register window. */
+#define IOAPIC_VER 0x01                 /* Version register. */
+#define IOAPIC_REDTBL 0x10              /* First redirection entry. */
+#define IOAPIC_MASKED 0x00010000        /* Redirection entry masked. */
+
+static volatile uint8_t *ioapic_base;
+static int ioapic_pin_cnt;              /* Number of input pins. */
+
+static void lapic_wait_icr (void);
+static void *map_mmio (uint64_t pa);
+static uint64_t mp_find_ioapic (void);
+static uint32_t ioapic_read (uint32_t reg);
+static void ioapic_write (uint32_t reg, uint32_t value);
+
+/* Maps the local APIC of the calling CPU and software-enables
+   it.  Returns false if this CPU has no local APIC. */
+bool
+lapic_init (void) {
+	uint32_t eax = 1, ebx, ecx = 0, edx;
+	uint64_t pa;
+
+	asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	if (!(edx & CPUID_APIC))
+		return false;
+
+	pa = read_msr (MSR_APIC_BASE);
+	if (!(pa & APIC_BASE_ENABLE))
+		write_msr (MSR_APIC_BASE, pa | APIC_BASE_ENABLE);
+	pa = PTE_ADDR (pa) & 0xffffffffffUL;
+
+	if (lapic_base == NULL && (lapic_base = map_mmio (pa)) == NULL)
+		return false;
+
+	lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+	return true;
+}
+
+/* Returns true if the local APIC has been mapped. */
+bool
+lapic_present (void) {
+	return lapic_base != NULL;
+}
+
+/* Reads local APIC register REG. */
+uint32_t
+lapic_read (uint32_t reg) {
+	ASSERT (lapic_base != NULL);
+	return *(volatile uint32_t *) (lapic_base + reg);
+}
+
+/* Writes VALUE to local APIC register REG. */
+void
+lapic_write (uint32_t reg, uint32_t value) {
+	ASSERT (lapic_base != NULL);
+	*(volatile uint32_t *) (lapic_base + reg) = value;
+}
+
+/* Returns the local APIC ID of the calling CPU. */
+uint8_t
+lapic_id (void) {
+	return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Signals end of interrupt to the local APIC.  Unlike the PIC,
+   the local APIC tracks which interrupt is in service itself, so
+   there is nothing to say about the vector. */
+void
+lapic_eoi (void) {
+	lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends an INIT IPI to every CPU but the caller, which resets
+   them into the wait-for-SIPI state. */
+void
+lapic_send_init (void) {
+	lapic_write (LAPIC_ICR_HI, 0);
+	lapic_write (LAPIC_ICR_LO, ICR_ALL_BUT_SELF | ICR_ASSERT | ICR_INIT);
+	lapic_wait_icr ();
+}
+
+/* Sends a start-up IPI to every CPU but the caller.  CPUs in the
+   wait-for-SIPI state begin executing real-mode code at PADDR,
+   which must be page aligned and below 1 MB. */
+void
+lapic_send_startup (uint64_t paddr) {
+	ASSERT (paddr % PGSIZE == 0 && paddr < 0x100000);
+
+	lapic_write (LAPIC_ICR_HI, 0);
+	lapic_write (LAPIC_ICR_LO,
+			ICR_ALL_BUT_SELF | ICR_ASSERT | ICR_STARTUP | (paddr >> 12));
+	lapic_wait_icr ();
+}
+
+/* Sends an interrupt with vector VEC to the CPU whose local APIC
+   ID is LAPIC_ID. */
+void
+lapic_send_ipi (uint8_t lapic_id, uint8_t vec) {
+	lapic_write (LAPIC_ICR_HI, (uint32_t) lapic_id << 24);
+	lapic_write (LAPIC_ICR_LO, ICR_ASSERT | vec);
+	lapic_wait_icr ();
+}
+
+/* Waits for the last interprocessor interrupt to be accepted. */
+static void
+lapic_wait_icr (void) {
+	while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+		asm volatile ("pause");
+}
+
+/* Locates and maps the I/O APIC and masks all of its inputs.
+   Returns false if it cannot be found. */
+bool
+ioapic_init (void) {
+	uint64_t pa = mp_find_ioapic ();
+	int i;
+
+	if (pa == 0)
+		pa = IOAPIC_DEFAULT_BASE;
+	if ((ioapic_base = map_mmio (pa)) == NULL)
+		return false;
+
+	/* Reads of nonexistent MMIO return all ones. */
+	uint32_t ver = ioapic_read (IOAPIC_VER);
+	if (ver == 0xffffffff) {
+		ioapic_base = NULL;
+		return false;
+	}
+	ioapic_pin_cnt = ((ver >> 16) & 0xff) + 1;
+
+	for (i = 0; i < ioapic_pin_cnt; i++) {
+		ioapic_write (IOAPIC_REDTBL + 2 * i, IOAPIC_MASKED);
+		ioapic_write (IOAPIC_REDTBL + 2 * i + 1, 0);
+	}
+	return true;
+}
+
+/* Routes ISA interrupt line IRQ to vector VEC on the calling
+   CPU, edge triggered and active high, and unmasks it.  ISA
+   IRQs are assumed to be wired to the I/O APIC pin of the same
+   number, which holds for everything but the 8254 timer. */
+void
+ioapic_route (int irq, uint8_t vec) {
+	ASSERT (ioapic_base != NULL);
+	ASSERT (irq >= 0 && irq < ioapic_pin_cnt);
+
+	ioapic_write (IOAPIC_REDTBL + 2 * irq + 1, (uint32_t) lapic_id () << 24);
+	ioapic_write (IOAPIC_REDTBL + 2 * irq, vec);
+}
+
+static uint32_t
+ioapic_read (uint32_t reg) {
+	*(volatile uint32_t *) (ioapic_base + IOREGSEL) = reg;
+	return *(volatile uint32_t *) (ioapic_base + IOWIN);
+}
+
+static void
+ioapic_write (uint32_t reg, uint32_t value) {
+	*(volatile uint32_t *) (ioapic_base + IOREGSEL) = reg;
+	*(volatile uint32_t *) (ioapic_base + IOWIN) = value;
+}
+
+/* Maps the page of device registers at physical address PA
+   uncached into the kernel address space.  Returns its kernel
+   virtual address, or a null pointer if out of memory. */
+static void *
+map_mmio (uint64_t pa) {
+	uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) ptov (pa), 1);
+
+	if (pte == NULL)
+		return NULL;
+	*pte = PTE_ADDR (pa) | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+	return ptov (pa);
+}
+
+/* MP floating pointer structure and configuration table header.
+   See the Intel MultiProcessor Specification, chapter 4. */
+struct mp_float {
+	char signature[4];          /* "_MP_". */
+	uint32_t config;            /* Physical address of mp_config. */
+	uint8_t length;             /* In 16-byte units. */
+	uint8_t revision;
+	uint8_t checksum;
+	uint8_t features[5];
+} __attribute__((packed));
+
+struct mp_config {
+	char signature[4];          /* "PCMP". */
+	uint16_t length;            /* Base table length. */
+	uint8_t revision;
+	uint8_t checksum;
+	char oem[8];
+	char product[12];
+	uint32_t oem_table;
+	uint16_t oem_length;
+	uint16_t entry_cnt;         /* Entries following the header. */
+	uint32_t lapic;             /* Local APIC physical address. */
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__((packed));
+
+#define MP_ENTRY_PROCESSOR 0        /* 20 bytes; all others are 8. */
+#define MP_ENTRY_IOAPIC 2
+
+/* I/O APIC entry in the configuration table. */
+struct mp_ioapic {
+	uint8_t type;               /* MP_ENTRY_IOAPIC. */
+	uint8_t id;
+	uint8_t version;
+	uint8_t flags;              /* Bit 0: usable. */
+	uint32_t addr;              /* Physical address. */
+} __attribute__((packed));
+
+/* Returns true if the LEN bytes at P sum to 0 mod 256. */
+static bool
+mp_checksum_ok (const void *p, size_t len) {
+	const uint8_t *b = p;
+	uint8_t sum = 0;
+
+	while (len-- > 0)
+		sum += *b++;
+	return sum == 0;
+}
+
+/* Searches the LEN bytes of physical memory at PA for an MP
+   floating pointer structure. */
+static struct mp_float *
+mp_search (uint64_t pa, size_t len) {
+	uint8_t *p = ptov (pa), *end = p + len;
+
+	for (; p + sizeof (struct mp_float) <= end; p += 16)
+		if (!memcmp (p, "_MP_", 4) && mp_checksum_ok (p, sizeof (struct mp_float)))
+			return (struct mp_float *) p;
+	return NULL;
+}
+
+/* Returns the physical address of the first usable I/O APIC
+   listed in the BIOS's MP configuration table, or 0 if there is
+   no such table. */
+static uint64_t
+mp_find_ioapic (void) {
+	uint64_t ebda = (uint64_t) *(uint16_t *) ptov (0x40e) << 4;
+	struct mp_float *mpf = NULL;
+	struct mp_config *conf;
+	uint8_t *e;
+	int i;
+
+	if (ebda != 0)
+		mpf = mp_search (ebda, 1024);
+	if (mpf == NULL)
+		mpf = mp_search (0x9fc00, 1024);
+	if (mpf == NULL)
+		mpf = mp_search (0xf0000, 0x10000);
+	if (mpf == NULL || mpf->config == 0)
+		return 0;
+
+	conf = ptov ((uint64_t) mpf->config);
+	if (memcmp (conf->signature, "PCMP", 4)
+			|| !mp_checksum_ok (conf, conf->length))
+		return 0;
+
+	e = (uint8_t *) (conf + 1);
+	for (i = 0; i < conf->entry_cnt; i++) {
+		if (*e == MP_ENTRY_IOAPIC) {
+			struct mp_ioapic *io = (struct mp_ioapic *) e;
+			if (io->flags & 1)
+				return io->addr;
+		}
+		e += *e == MP_ENTRY_PROCESSOR ? 20 : 8;
+	}
+	return 0;
+}
@@ -0,0 +1,158 @@
+#include "threads/futex.h"
+#include <debug.h>
+#include <list.h>
+#include <stddef.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Futexes ("fast user-space mutexes").
+
+   A futex is an aligned 32-bit word in memory.  User code takes
+   and releases locks built on it with atomic instructions alone
+   and enters the kernel only under contention: to sleep until
+   the word changes (futex_wait) or to wake the threads sleeping
+   on it (futex_wake, futex_requeue).
+
+   Waiters are keyed by the kernel virtual address of the word.
+   For a user word, the system call layer translates the user
+   address first, so the key names the physical frame the word
+   lives in, and processes that map the same frame wait on the
+   same futex.  Keys hash into a fixed table of buckets, each a
+   priority wait queue like a semaphore's, so a wake-up always
+   goes to the highest-priority waiter on the word. */
+
+#define FUTEX_HASH_BITS 6
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+static struct waitq futex_buckets[FUTEX_HASH_SIZE];
+
+static struct waitq *futex_bucket (uintptr_t key);
+static int futex_move (uintptr_t key, int cnt, uintptr_t to);
+
+/* Initializes the futex hash table. */
+void
+futex_init (void) {
+	for (int i = 0; i < FUTEX_HASH_SIZE; i++)
+		waitq_init (&futex_buckets[i]);
+}
+
+/* Blocks the running thread on the futex at WORD if the word
+   still holds VAL, until another thread wakes it.  Returns 0
+   once woken, or -1 without sleeping if WORD no longer holds
+   VAL, in which case the caller should re-read the word and
+   retry.  WORD is a kernel address. */
+int
+futex_wait (uint32_t *word, uint32_t val) {
+	struct thread *curr = thread_current ();
+	uintptr_t key = (uintptr_t) word;
+	enum intr_level old_level;
+	int result = -1;
+
+	ASSERT (word != NULL && key % sizeof *word == 0);
+	ASSERT (!intr_context ());
+
+	/* The value check and the enqueue are atomic with respect to
+	   futex_wake, so a wake-up between them cannot be lost. */
+	old_level = intr_disable ();
+	if (*word == val) {
+		curr->futex_key = key;
+		waitq_push (futex_bucket (key), curr);
+		thread_block ();
+		result = 0;
+	}
+	intr_set_level (old_level);
+	return result;
+}
+
+/* Wakes up to CNT threads waiting on the futex at WORD, highest
+   priority first.  Returns the number woken. */
+int
+futex_wake (uint32_t *word, int cnt) {
+	return futex_requeue (word, cnt, NULL, 0);
+}
+
+/* Wakes up to WAKE_CNT threads waiting on the futex at WORD and
+   moves up to MOVE_CNT of the rest to wait on WORD2 instead,
+   without waking them.  This lets a condition variable broadcast
+   wake one waiter and hand the others straight to the mutex
+   rather than letting them all stampede for it.  WORD2 may be
+   null to only wake.  Returns the number of threads woken plus
+   moved. */
+int
+futex_requeue (uint32_t *word, int wake_cnt,
+		uint32_t *word2, int move_cnt) {
+	uintptr_t key = (uintptr_t) word, key2 = (uintptr_t) word2;
+	enum intr_level old_level;
+	int result;
+
+	ASSERT (word != NULL && key % sizeof *word == 0);
+	ASSERT (key2 % sizeof *word2 == 0);
+
+	old_level = intr_disable ();
+	result = futex_move (key, wake_cnt, 0);
+	if (key2 != 0 && key2 != key)
+		result += futex_move (key, move_cnt, key2);
+	thread_try_preemption ();
+	intr_set_level (old_level);
+	return result;
+}
+
+/* Wakes up T if it is sleeping on a futex, as though the futex
+   had been woken.  Interrupts must be off. */
+void
+futex_cancel (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->futex_key != 0) {
+		waitq_remove (t);
+		t->futex_key = 0;
+		thread_unblock (t);
+	}
+}
+
+/* Returns the bucket that waiters on KEY sleep in. */
+static struct waitq *
+futex_bucket (uintptr_t key) {
+	/* Fibonacci hashing of the word index. */
+	return &futex_buckets[((key >> 2) * 0x9e3779b97f4a7c15ULL)
+		>> (64 - FUTEX_HASH_BITS)];
+}
+
+/* Takes up to CNT threads waiting on KEY out of its bucket, in
+   priority order.  If TO is 0 they are woken; otherwise they are
+   re-keyed to wait on TO.  Returns the number taken.  Interrupts
+   must be off. */
+static int
+futex_move (uintptr_t key, int cnt, uintptr_t to) {
+	struct waitq *q = futex_bucket (key);
+	struct list others;
+	int moved = 0;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* Other keys may share the bucket.  Set their waiters aside
+	   and put them back afterward; re-pushing keeps them in
+	   priority order. */
+	list_init (&others);
+	while (moved < cnt && !waitq_empty (q)) {
+		struct thread *t = waitq_pop (q);
+
+		if (t->futex_key != key)
+			list_push_back (&others, &t->elem);
+		else {
+			moved++;
+			if (to == 0) {
+				t->futex_key = 0;
+				thread_unblock (t);
+			} else {
+				t->futex_key = to;
+				waitq_push (futex_bucket (to), t);
+			}
+		}
+	}
+	while (!list_empty (&others))
+		waitq_push (q, list_entry (list_pop_front (&others),
+					struct thread, elem));
+	return moved;
+}
@@ -13,13 +13,18 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/futex.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -81,10 +86,12 @@ main (void) {
 	   then enable console locking. */
 	thread_init ();
 	console_init ();
+	futex_init ();
 
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	kmem_init ();
 	paging_init (mem_end);
 
 #ifdef USERPROG
@@ -105,7 +112,8 @@ main (void) {
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
-
+	smp_init ();
+	profile_init ();
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -223,6 +231,19 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-pic"))
+			intr_force_pic = true;
+		else if (!strcmp (name, "-profile"))
+			profile_hz = value != NULL ? atoi (value) : PROFILE_HZ_DEFAULT;
+		else if (!strcmp (name, "-smp")) {
+			smp_cpu_cnt = atoi (value);
+			if (smp_cpu_cnt < 1 || smp_cpu_cnt > CPU_MAX)
+				PANIC ("-smp must be between 1 and %d", CPU_MAX);
+		}
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -232,6 +253,8 @@ parse_options (char **argv) {
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs cannot be used together");
 
 	return argv;
 }
@@ -254,6 +277,28 @@ run_task (char **argv) {
 	printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Stops the profiler and prints its samples. */
+static void
+run_profile (char **argv UNUSED) {
+	profile_print ();
+}
+
+#ifdef FILESYS
+/* Stops the profiler and saves its samples to file ARGV[1]. */
+static void
+run_profile_save (char **argv) {
+	profile_save (argv[1]);
+}
+#endif
+
+#ifdef LOCKSTAT
+/* Prints lock contention statistics gathered so far. */
+static void
+run_lockstat (char **argv UNUSED) {
+	lockstat_print ();
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -274,6 +319,11 @@ run_actions (char **argv) {
 		{"rm", 2, fsutil_rm},
 		{"put", 2, fsutil_put},
 		{"get", 2, fsutil_get},
+		{"profile-save", 2, run_profile_save},
+#endif
+		{"profile", 1, run_profile},
+#ifdef LOCKSTAT
+		{"lockstat", 1, run_lockstat},
 #endif
 		{NULL, 0, NULL},
 	};
@@ -321,6 +371,11 @@ usage (void) {
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
 			"  put FILE           Put FILE into file system from scratch disk.\n"
 			"  get FILE           Get FILE from file system into scratch disk.\n"
+			"  profile-save FILE  Save profiler samples to FILE.\n"
+#endif
+			"  profile            Print profiler samples.\n"
+#ifdef LOCKSTAT
+			"  lockstat           Print lock contention statistics.\n"
 #endif
 			"\nOptions:\n"
 			"  -h                 Print this help message and power off.\n"
@@ -328,6 +383,11 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use completely fair scheduler.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -pic               Use the 8259A PIC and 8254 PIT, not the APICs.\n"
+			"  -profile[=HZ]      Sample running code HZ times a second.\n"
+			"  -smp=N             Run threads on N CPUs.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -356,6 +416,9 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	kmem_print_stats ();
+	profile_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -3,16 +3,20 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/apic.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/smp.h"
+#include "threads/softirq.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -94,17 +98,43 @@ static intr_handler_func *intr_handlers[INTR_CNT];
 static const char *intr_names[INTR_CNT];
 
 /* External interrupts are those generated by devices outside the
-   CPU, such as the timer.  External interrupts run with
-   interrupts turned off, so they never nest, nor are they ever
-   pre-empted.  Handlers for external interrupts also may not
-   sleep, although they may invoke intr_yield_on_return() to
-   request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   CPU, such as the timer, and interprocessor interrupts that ask
+   for a reschedule.  External interrupts run with interrupts
+   turned off, so they never nest, nor are they ever pre-empted.
+   Handlers for external interrupts also may not sleep, although
+   they may invoke intr_yield_on_return() to request that a new
+   process be scheduled just before the interrupt returns.  Each
+   CPU keeps track of its own external interrupt in struct cpu. */
+
+/* Global interrupt lock.  The kernel keeps other threads out of
+   a critical section by turning interrupts off, which on its own
+   only works on a single CPU.  So a CPU also holds this lock for
+   as long as its interrupts are off: intr_disable() takes it and
+   intr_enable() releases it, and so does intr_handler() for
+   interrupts that arrive with interrupts on.  The result is that
+   at most one CPU at a time runs with interrupts off, and every
+   critical section that relies on that, in the scheduler,
+   semaphores, timers and so on, works unchanged on every CPU.
+
+   The lock belongs to the CPU, not to the thread: it stays held
+   across a thread switch, which happens with interrupts off, and
+   is released by whichever thread turns interrupts back on.  The
+   BSP boots with interrupts off, so it starts out holding the
+   lock.  Also released by do_iret(). */
+volatile int intr_lock = 1;
+
+/* If false (default), external interrupts are delivered through
+   the I/O APIC and acknowledged with a local APIC MMIO write, if
+   the machine has them.  If true, the 8259A PICs are used.
+   Controlled by kernel command-line option "-pic". */
+bool intr_force_pic;
+
+/* Are external interrupts delivered through the APICs? */
+static bool apic_enabled;
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
+static void pic_mask_all (void);
 static void pic_end_of_interrupt (int irq);
 
 /* Interrupt handlers. */
@@ -137,6 +167,9 @@ intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF)
+		intr_lock_release ();
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -156,16 +189,53 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON)
+		intr_lock_acquire ();
+
 	return old_level;
 }
 
+/* Takes the global interrupt lock for the running CPU, whose
+   interrupts must already be off.  Only needed where interrupts
+   are turned off without intr_disable(): on entry to an
+   interrupt handler, and when an application processor starts.
+
+   A TLB shootdown may be waiting for us with the lock held, so
+   we answer it while we spin. */
+void
+intr_lock_acquire (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (__atomic_exchange_n (&intr_lock, 1, __ATOMIC_ACQUIRE)) {
+		smp_tlb_flush_pending ();
+		asm volatile ("pause");
+	}
+}
+
+/* Releases the global interrupt lock, right before interrupts are
+   turned on other than by intr_enable(). */
+void
+intr_lock_release (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (intr_lock);
+
+	__atomic_store_n (&intr_lock, 0, __ATOMIC_RELEASE);
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
 	int i;
 
-	/* Initialize interrupt controller. */
+	/* Initialize interrupt controller.  The PICs are always
+	   remapped away from the exception vectors, even when the
+	   APICs take over, since they may still raise spurious
+	   interrupts. */
 	pic_init ();
+	if (!intr_force_pic && lapic_init () && ioapic_init ()) {
+		pic_mask_all ();
+		apic_enabled = true;
+	}
 
 	/* Initialize IDT. */
 	for (i = 0; i < INTR_CNT; i++) {
@@ -203,6 +273,18 @@ intr_init (void) {
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Loads the IDT built by intr_init() on an application
+   processor, and its TSS.  Called with interrupts disabled. */
+void
+intr_init_ap (void) {
+#ifdef USERPROG
+	/* Load TSS. */
+	ltr (SEL_TSS_CPU (cpu_current ()->id));
+#endif
+
+	lidt (&idt_desc);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -229,6 +311,18 @@ intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
 	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
+
+	/* IRQ 0 is the 8254, which is replaced by the local APIC
+	   timer in APIC mode and so is never routed. */
+	if (apic_enabled && vec_no != 0x20)
+		ioapic_route (vec_no - 0x20, vec_no);
+}
+
+/* Returns true if external interrupts are delivered through the
+   local APIC, false if through the 8259A PICs. */
+bool
+intr_apic_enabled (void) {
+	return apic_enabled;
 }
 
 /* Registers internal interrupt VEC_NO to invoke HANDLER, which
@@ -252,11 +346,11 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt or
+   of softirqs, and false at all other times. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	return cpu_current ()->in_external_intr || softirq_context ();
 }
 
 /* During processing of an external interrupt, directs the
@@ -266,7 +360,7 @@ intr_context (void) {
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
-	yield_on_return = true;
+	cpu_current ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -308,6 +402,14 @@ pic_init (void) {
 	outb (0xa1, 0x00);
 }
 
+/* Masks all interrupts on both PICs, once the I/O APIC has
+   taken over. */
+static void
+pic_mask_all (void) {
+	outb (0x21, 0xff);
+	outb (0xa1, 0xff);
+}
+
 /* Sends an end-of-interrupt signal to the PIC for the given IRQ.
    If we don't acknowledge the IRQ, it will never be delivered to
    us again, so this is important.  */
@@ -333,24 +435,47 @@ intr_handler (struct intr_frame *frame) {
 	bool external;
 	intr_handler_func *handler;
 
+	/* A TLB shootdown is answered right away, without the
+	   interrupt lock, which the CPU that asked for it holds while
+	   it waits for us. */
+	if (frame->vec_no == LAPIC_TLB_VEC) {
+		intr_handlers[frame->vec_no] (frame);
+		lapic_eoi ();
+		return;
+	}
+
+	/* Entering through an interrupt gate turned interrupts off, so
+	   take the interrupt lock, unless interrupts were already off
+	   and we hold it. */
+	if (intr_get_level () == INTR_OFF && (frame->eflags & FLAG_IF))
+		intr_lock_acquire ();
+
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	external = (frame->vec_no >= 0x20 && frame->vec_no < 0x30)
+		|| frame->vec_no == LAPIC_RESCHED_VEC
+		|| frame->vec_no == LAPIC_CLOCK_VEC;
 	if (external) {
+		struct cpu *c = cpu_current ();
+
 		ASSERT (intr_get_level () == INTR_OFF);
-		ASSERT (!intr_context ());
+		ASSERT (!c->in_external_intr);
 
-		in_external_intr = true;
-		yield_on_return = false;
+		c->in_external_intr = true;
+		/* An interrupt that arrives while softirqs run leaves any
+		   yield to the interrupt that started them. */
+		if (!softirq_context ())
+			c->yield_on_return = false;
 	}
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
 		handler (frame);
-	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+			|| frame->vec_no == LAPIC_SPURIOUS_VEC) {
 		/* There is no handler, but this interrupt can trigger
 		   spuriously due to a hardware fault or hardware race
 		   condition.  Ignore it. */
@@ -366,12 +491,37 @@ intr_handler (struct intr_frame *frame) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (intr_context ());
 
-		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
-
-		if (yield_on_return)
-			thread_yield ();
+		cpu_current ()->in_external_intr = false;
+		if (apic_enabled)
+			lapic_eoi ();
+		else
+			pic_end_of_interrupt (frame->vec_no);
+
+		/* Run the deferred work raised by this handler, with
+		   interrupts on, before giving up the CPU.  After the
+		   yield, we may be back on a different CPU. */
+		if (!softirq_context ()) {
+			softirq_run ();
+			if (cpu_current ()->yield_on_return)
+				thread_yield ();
+#ifdef USERPROG
+			/* A thread interrupted in user mode holds no kernel
+			   locks, so if its process is exiting it can go now. */
+			if (frame->cs == SEL_UCSEG && process_exiting ()) {
+				intr_enable ();
+				thread_exit ();
+			}
+#endif
+		}
 	}
+
+	/* The return restores the interrupted code's interrupt flag,
+	   so leave the interrupt lock as that code had it. */
+	if (frame->eflags & FLAG_IF) {
+		if (intr_get_level () == INTR_OFF)
+			intr_lock_release ();
+	} else if (intr_get_level () == INTR_ON)
+		intr_disable ();
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -11,9 +11,13 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages blocks
+   of that size.  Size classes start at 16 bytes and go up in
+   quarter-power-of-two steps (..., 64, 80, 96, 112, 128, ...), so
+   a request over 64 bytes wastes less than a fifth of its block,
+   and a table maps each request size straight to its
+   descriptor.  The descriptor keeps a list of free blocks.  If
    the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
@@ -32,14 +36,19 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   realloc() leaves a block where it is if the new size still
+   fits it without wasting more than half of it.  A big block
+   shrinks by giving its tail pages back, and grows in place if
+   the page allocator can hand over the pages right after it. */
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
-	struct lock lock;           /* Lock. */
+	struct spinlock lock;       /* Lock. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -58,24 +67,52 @@ struct block {
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Granularity of size classes and of the lookup table. */
+#define CLASS_ALIGN 8
+
+/* Largest block size, the most that fits twice in an arena. */
+#define MAX_BLOCK_SIZE \
+	ROUND_DOWN ((PGSIZE - sizeof (struct arena)) / 2, CLASS_ALIGN)
+
+/* Maps a request size, in units of CLASS_ALIGN bytes rounded up,
+   to the index of the smallest descriptor that satisfies it. */
+static uint8_t size_class[MAX_BLOCK_SIZE / CLASS_ALIGN + 1];
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static bool resize_in_place (void *block, size_t new_size);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t block_size, step, i;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	for (block_size = 16; block_size <= MAX_BLOCK_SIZE; block_size += step) {
 		struct desc *d = &descs[desc_cnt++];
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		spinlock_init (&d->lock);
+
+		/* Step by a quarter of the power of 2 at or below
+		   BLOCK_SIZE, but no finer than CLASS_ALIGN.  Let the
+		   last class take all the room there is. */
+		step = block_size;
+		while (step & (step - 1))
+			step &= step - 1;
+		step = step / 4 > CLASS_ALIGN ? step / 4 : CLASS_ALIGN;
+		if (block_size < MAX_BLOCK_SIZE && block_size + step > MAX_BLOCK_SIZE)
+			step = MAX_BLOCK_SIZE - block_size;
+	}
+
+	for (i = 0, block_size = 0; i < sizeof size_class; i++) {
+		while (descs[block_size].block_size < i * CLASS_ALIGN)
+			block_size++;
+		size_class[i] = block_size;
 	}
 }
 
@@ -93,10 +130,7 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	if (size > MAX_BLOCK_SIZE) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -111,8 +145,9 @@ malloc (size_t size) {
 		a->free_cnt = page_cnt;
 		return a + 1;
 	}
+	d = &descs[size_class[DIV_ROUND_UP (size, CLASS_ALIGN)]];
 
-	lock_acquire (&d->lock);
+	spinlock_acquire (&d->lock);
 
 	/* If the free list is empty, create a new arena. */
 	if (list_empty (&d->free_list)) {
@@ -121,7 +156,7 @@ malloc (size_t size) {
 		/* Allocate a page. */
 		a = palloc_get_page (0);
 		if (a == NULL) {
-			lock_release (&d->lock);
+			spinlock_release (&d->lock);
 			return NULL;
 		}
 
@@ -139,7 +174,7 @@ malloc (size_t size) {
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
 	a->free_cnt--;
-	lock_release (&d->lock);
+	spinlock_release (&d->lock);
 	return b;
 }
 
@@ -163,9 +198,10 @@ calloc (size_t a, size_t b) {
 	return p;
 }
 
-/* Returns the number of bytes allocated for BLOCK. */
-static size_t
-block_size (void *block) {
+/* Returns the number of bytes allocated for BLOCK, which may be
+   more than were asked for. */
+size_t
+malloc_usable_size (void *block) {
 	struct block *b = block;
 	struct arena *a = block_to_arena (b);
 	struct desc *d = a->desc;
@@ -184,10 +220,12 @@ realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
-	} else {
+	} else if (old_block != NULL && resize_in_place (old_block, new_size))
+		return old_block;
+	else {
 		void *new_block = malloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
-			size_t old_size = block_size (old_block);
+			size_t old_size = malloc_usable_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
 			memcpy (new_block, old_block, min_size);
 			free (old_block);
@@ -213,7 +251,7 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
+			spinlock_acquire (&d->lock);
 
 			/* Add block to free list. */
 			list_push_front (&d->free_list, &b->free_elem);
@@ -230,7 +268,7 @@ free (void *p) {
 				palloc_free_page (a);
 			}
 
-			lock_release (&d->lock);
+			spinlock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -239,6 +277,35 @@ free (void *p) {
 	}
 }
 
+/* Tries to make BLOCK hold NEW_SIZE bytes without moving it.
+   Returns true if successful, false if it must move. */
+static bool
+resize_in_place (void *block, size_t new_size) {
+	struct arena *a = block_to_arena (block);
+	size_t page_cnt;
+
+	if (a->desc != NULL) {
+		/* Stay put unless that would waste over half the block. */
+		return new_size <= a->desc->block_size
+			&& new_size > a->desc->block_size / 2;
+	}
+
+	/* A big block that shrinks to a small size moves, so that its
+	   pages go back. */
+	if (new_size <= MAX_BLOCK_SIZE)
+		return false;
+
+	page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+	if (page_cnt < a->free_cnt)
+		palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+				a->free_cnt - page_cnt);
+	else if (page_cnt > a->free_cnt
+			&& !palloc_extend (a, a->free_cnt, page_cnt - a->free_cnt))
+		return false;
+	a->free_cnt = page_cnt;
+	return true;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
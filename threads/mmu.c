@@ -4,6 +4,7 @@
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
@@ -155,14 +156,26 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	return true;
 }
 
+/* Number of pages pt_destroy() hands back at a time. */
+#define FREE_BATCH 32
+
 static void
 pt_destroy (uint64_t *pt) {
+	void *pages[FREE_BATCH];
+	size_t cnt = 0;
+
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pt[i]);
-		if (((uint64_t) pte) & PTE_P)
-			palloc_free_page ((void *) PTE_ADDR (pte));
+		if (((uint64_t) pte) & PTE_P) {
+			pages[cnt++] = (void *) PTE_ADDR (pte);
+			if (cnt == FREE_BATCH) {
+				palloc_free_batch (pages, cnt);
+				cnt = 0;
+			}
+		}
 	}
-	palloc_free_page ((void *) pt);
+	pages[cnt++] = pt;
+	palloc_free_batch (pages, cnt);
 }
 
 static void
@@ -203,7 +216,19 @@ pml4_destroy (uint64_t *pml4) {
  * register. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t cr3 = vtop (pml4 ? pml4 : base_pml4);
+
+	cpu_current ()->cr3 = cr3;
+	lcr3 (cr3);
+}
+
+/* Flushes stale TLB entries for VPAGE in PML4, on every CPU that
+ * has PML4 loaded. */
+static void
+pml4_flush_page (uint64_t *pml4, const void *vpage) {
+	if (rcr3 () == vtop (pml4))
+		invlpg ((uint64_t) vpage);
+	smp_tlb_shootdown (vtop (pml4));
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -257,8 +282,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_flush_page (pml4, upage);
 	}
 }
 
@@ -283,8 +307,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_flush_page (pml4, vpage);
 	}
 }
 
@@ -309,7 +332,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_flush_page (pml4, vpage);
 	}
 }
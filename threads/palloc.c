@@ -2,12 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -24,13 +26,61 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages are kept
+   as blocks of 2**ORDER pages, each aligned to its own size in
+   physical page numbers, on one free list per order.  A request
+   takes the smallest block big enough, splitting larger ones as
+   needed, and returns the unused tail; freed pages merge with
+   their free buddies into larger blocks again.  Free lists live
+   in a per-page array rather than in the free pages themselves,
+   because not all of memory is mapped when the pools are built.
+
+   In front of each pool sits a magazine: a small LIFO cache of
+   free single pages, so that most single-page allocations and
+   frees touch neither the buddy lists, the bitmap nor the pool's
+   lock.  Pages in a magazine still count as used in the bitmap.
+   A magazine is protected by turning interrupts off, which
+   is enough while a single CPU allocates memory (the others are
+   parked).  It is drained back into the pool when an allocation
+   would otherwise fail.
+
+   A second magazine holds pages that are already zeroed.  The
+   idle thread fills it, through palloc_zero_idle(), while the CPU
+   has nothing else to do, and single-page PAL_ZERO allocations
+   draw from it first instead of zeroing on the spot. */
+
+/* Largest block, as a power of two pages. */
+#define MAX_ORDER 18
+
+/* Buddy allocator state for one page of a pool. */
+struct page_info {
+	struct list_elem elem;          /* Free list element, if a block head. */
+	uint8_t free_order;             /* 1 + order if it heads a free block. */
+};
+
+/* Most pages kept in a magazine. */
+#define MAG_SIZE 32
+
+/* A LIFO cache of free single pages in front of a pool. */
+struct magazine {
+	size_t cnt;                     /* Number of pages in PAGES. */
+	void *pages[MAG_SIZE];          /* Free pages, most recent last. */
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
+	struct spinlock lock;           /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	struct page_info *pages;        /* One per page of the pool. */
+	struct list free_lists[MAX_ORDER + 1];  /* Free blocks by order. */
+	size_t free_cnt[MAX_ORDER + 1]; /* Number of blocks in each list. */
+	struct magazine mag;            /* Cache of free single pages. */
+	struct magazine zeroed;         /* Cache of zeroed free pages. */
+	uint64_t zero_hits;             /* PAL_ZERO requests served zeroed. */
+	uint64_t zero_misses;           /* PAL_ZERO requests zeroed on demand. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +92,17 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static struct pool *page_pool (void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_claim (struct pool *, size_t page_idx, size_t page_cnt);
+static void *pool_take (struct pool *, size_t page_cnt);
+static void pool_give (struct pool *, void *pages, size_t page_cnt);
+static void *mag_get (struct magazine *);
+static bool mag_put (struct pool *, void *page);
+static void mag_refill (struct pool *);
+static void mag_drain (struct pool *, struct magazine *, size_t keep);
+static void zero_pages (void *pages, size_t page_cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +285,13 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,20 +325,38 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	bool zeroed = false;
+	void *pages = NULL;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
+	if (page_cnt == 1) {
+		if (flags & PAL_ZERO)
+			zeroed = (pages = mag_get (&pool->zeroed)) != NULL;
+		if (pages == NULL)
+			pages = mag_get (&pool->mag);
+	}
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (pages == NULL) {
+		spinlock_acquire (&pool->lock);
+		pages = pool_take (pool, page_cnt);
+		if (pages == NULL && pool->mag.cnt + pool->zeroed.cnt > 0) {
+			/* Short of memory: give the magazines' pages back to
+			   the buddy lists, where they may merge, and retry. */
+			mag_drain (pool, &pool->mag, 0);
+			mag_drain (pool, &pool->zeroed, 0);
+			pages = pool_take (pool, page_cnt);
+		}
+		if (pages != NULL && page_cnt == 1)
+			mag_refill (pool);
+		spinlock_release (&pool->lock);
+	}
 
 	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+		if (flags & PAL_ZERO) {
+			if (!zeroed)
+				zero_pages (pages, page_cnt);
+			__atomic_fetch_add (zeroed ? &pool->zero_hits : &pool->zero_misses,
+					1, __ATOMIC_RELAXED);
+		}
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -300,26 +381,27 @@ palloc_get_page (enum palloc_flags flags) {
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
-	size_t page_idx;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
 		return;
 
-	if (page_from_pool (&kernel_pool, pages))
-		pool = &kernel_pool;
-	else if (page_from_pool (&user_pool, pages))
-		pool = &user_pool;
-	else
-		NOT_REACHED ();
-
-	page_idx = pg_no (pages) - pg_no (pool->base);
-
+	pool = page_pool (pages);
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	if (page_cnt == 1 && mag_put (pool, pages))
+		return;
+
+	spinlock_acquire (&pool->lock);
+	if (page_cnt == 1) {
+		/* The magazine is full.  Make room for this page and the
+		   next few. */
+		mag_drain (pool, &pool->mag, MAG_SIZE / 2);
+		mag_put (pool, pages);
+	} else
+		pool_give (pool, pages, page_cnt);
+	spinlock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +410,150 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Tries to grow the block of PAGE_CNT pages starting at PAGES,
+   which must have been obtained with palloc_get_multiple(), by
+   the EXTRA_CNT pages that follow it.  Returns true and marks
+   them used if they are all free, otherwise returns false and
+   changes nothing.  The added pages are not zeroed. */
+bool
+palloc_extend (void *pages, size_t page_cnt, size_t extra_cnt) {
+	struct pool *pool = page_pool (pages);
+	size_t page_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+	bool success = false;
+
+	ASSERT (pg_ofs (pages) == 0);
+	spinlock_acquire (&pool->lock);
+	if (page_idx + extra_cnt <= bitmap_size (pool->used_map)
+			&& bitmap_none (pool->used_map, page_idx, extra_cnt)) {
+		buddy_claim (pool, page_idx, extra_cnt);
+		bitmap_set_multiple (pool->used_map, page_idx, extra_cnt, true);
+		success = true;
+	}
+	spinlock_release (&pool->lock);
+	return success;
+}
+
+/* Called by the idle thread, with interrupts on, when there is
+   nothing to run.  Zeroes one free page and adds it to the
+   zeroed-page magazine of the pool that has the fewest.  Returns
+   false, doing nothing, if both are full or there is no free
+   page. */
+bool
+palloc_zero_idle (void) {
+	struct pool *pool = kernel_pool.zeroed.cnt <= user_pool.zeroed.cnt
+		? &kernel_pool : &user_pool;
+	enum intr_level old_level;
+	void *page;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	if (pool->zeroed.cnt >= MAG_SIZE)
+		return false;
+
+	page = mag_get (&pool->mag);
+	if (page == NULL) {
+		spinlock_acquire (&pool->lock);
+		page = pool_take (pool, 1);
+		spinlock_release (&pool->lock);
+		if (page == NULL)
+			return false;
+	}
+	zero_pages (page, 1);
+
+	/* Only the idle thread adds to the zeroed magazine, so there
+	   is still room. */
+	old_level = intr_disable ();
+	ASSERT (pool->zeroed.cnt < MAG_SIZE);
+	pool->zeroed.pages[pool->zeroed.cnt++] = page;
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Obtains up to PAGE_CNT single pages, not necessarily
+   contiguous, stores their addresses in PAGES[], and returns how
+   many it obtained.  FLAGS are as for palloc_get_page(); with
+   PAL_ASSERT, the kernel panics unless it obtains them all.
+   Cheaper than as many calls to palloc_get_page(): the pages
+   come from the magazines, then from the pool under a single hold
+   of its lock. */
+size_t
+palloc_get_batch (enum palloc_flags flags, void **pages, size_t page_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+	size_t got = 0, zeroed = 0, i;
+
+	old_level = intr_disable ();
+	if (flags & PAL_ZERO) {
+		while (zeroed < page_cnt && pool->zeroed.cnt > 0)
+			pages[zeroed++] = pool->zeroed.pages[--pool->zeroed.cnt];
+		pool->zero_hits += zeroed;
+		got = zeroed;
+	}
+	while (got < page_cnt && pool->mag.cnt > 0)
+		pages[got++] = pool->mag.pages[--pool->mag.cnt];
+	intr_set_level (old_level);
+
+	if (got < page_cnt) {
+		spinlock_acquire (&pool->lock);
+		while (got < page_cnt && (pages[got] = pool_take (pool, 1)) != NULL)
+			got++;
+		if (got < page_cnt && pool->zeroed.cnt > 0) {
+			/* Short of memory: take the zeroed pages too. */
+			mag_drain (pool, &pool->zeroed, 0);
+			while (got < page_cnt
+					&& (pages[got] = pool_take (pool, 1)) != NULL)
+				got++;
+		}
+		spinlock_release (&pool->lock);
+	}
+
+	if (flags & PAL_ZERO) {
+		for (i = zeroed; i < got; i++)
+			zero_pages (pages[i], 1);
+		__atomic_fetch_add (&pool->zero_misses, got - zeroed, __ATOMIC_RELAXED);
+	}
+	if (got < page_cnt && (flags & PAL_ASSERT))
+		PANIC ("palloc_get_batch: out of pages");
+	return got;
+}
+
+/* Frees the PAGE_CNT single pages whose addresses are in PAGES[],
+   which may come from either pool.  Each run of pages from one
+   pool refills its magazine and then goes back to the pool under
+   a single hold of its lock. */
+void
+palloc_free_batch (void **pages, size_t page_cnt) {
+	while (page_cnt > 0) {
+		struct pool *pool = page_pool (pages[0]);
+		enum intr_level old_level;
+		size_t run_cnt, i;
+
+		for (run_cnt = 0; run_cnt < page_cnt; run_cnt++) {
+			if (!page_from_pool (pool, pages[run_cnt]))
+				break;
+			ASSERT (pg_ofs (pages[run_cnt]) == 0);
+#ifndef NDEBUG
+			memset (pages[run_cnt], 0xcc, PGSIZE);
+#endif
+		}
+
+		old_level = intr_disable ();
+		for (i = 0; i < run_cnt; i++)
+			if (!mag_put (pool, pages[i]))
+				break;
+		intr_set_level (old_level);
+
+		if (i < run_cnt) {
+			spinlock_acquire (&pool->lock);
+			for (; i < run_cnt; i++)
+				pool_give (pool, pages[i], 1);
+			spinlock_release (&pool->lock);
+		}
+
+		pages += run_cnt;
+		page_cnt -= run_cnt;
+	}
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -336,8 +562,10 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t info_pages = DIV_ROUND_UP (pgcnt * sizeof *p->pages, PGSIZE) * PGSIZE;
+	int order;
 
-	lock_init(&p->lock);
+	spinlock_init (&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
 
@@ -345,6 +573,20 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	bitmap_set_all(p->used_map, true);
 
 	*bm_base += bm_pages;
+
+	// The buddy allocator starts with no free blocks.
+	p->pages = *bm_base;
+	memset (p->pages, 0, info_pages);
+	for (order = 0; order <= MAX_ORDER; order++) {
+		list_init (&p->free_lists[order]);
+		p->free_cnt[order] = 0;
+	}
+	p->mag.cnt = 0;
+	p->zeroed.cnt = 0;
+	p->zero_hits = 0;
+	p->zero_misses = 0;
+
+	*bm_base += info_pages;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -356,3 +598,282 @@ page_from_pool (const struct pool *pool, void *page) {
 	size_t end_page = start_page + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the pool that PAGE belongs to. */
+static struct pool *
+page_pool (void *page) {
+	if (page_from_pool (&kernel_pool, page))
+		return &kernel_pool;
+	else if (page_from_pool (&user_pool, page))
+		return &user_pool;
+	else
+		NOT_REACHED ();
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL's buddy lists and
+   returns the first, or a null pointer if there is no room.
+   POOL's lock must be held. */
+static void *
+pool_take (struct pool *pool, size_t page_cnt) {
+	size_t page_idx = buddy_alloc (pool, page_cnt);
+
+	if (page_idx == BITMAP_ERROR)
+		return NULL;
+	ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	return pool->base + PGSIZE * page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGES to POOL's buddy
+   lists.  POOL's lock must be held. */
+static void
+pool_give (struct pool *pool, void *pages, size_t page_cnt) {
+	size_t page_idx = pg_no (pages) - pg_no (pool->base);
+
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free (pool, page_idx, page_cnt);
+}
+
+/* Takes the most recently added page from MAG, or returns a null
+   pointer if it is empty. */
+static void *
+mag_get (struct magazine *mag) {
+	enum intr_level old_level = intr_disable ();
+	void *page = NULL;
+
+	if (mag->cnt > 0)
+		page = mag->pages[--mag->cnt];
+	intr_set_level (old_level);
+	return page;
+}
+
+/* Puts PAGE, which must be allocated, into POOL's magazine.
+   Returns false if the magazine is full.  Pages in either of
+   POOL's magazines are marked used in its bitmap, so a page freed
+   twice is caught by looking for it in both. */
+static bool
+mag_put (struct pool *pool, void *page) {
+	enum intr_level old_level = intr_disable ();
+	bool success = pool->mag.cnt < MAG_SIZE;
+
+#ifndef NDEBUG
+	size_t i;
+
+	ASSERT (bitmap_test (pool->used_map, pg_no (page) - pg_no (pool->base)));
+	for (i = 0; i < pool->mag.cnt; i++)
+		ASSERT (pool->mag.pages[i] != page);
+	for (i = 0; i < pool->zeroed.cnt; i++)
+		ASSERT (pool->zeroed.pages[i] != page);
+#endif
+	if (success)
+		pool->mag.pages[pool->mag.cnt++] = page;
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Fills POOL's magazine halfway from its buddy lists, as far as
+   they allow.  POOL's lock must be held. */
+static void
+mag_refill (struct pool *pool) {
+	while (pool->mag.cnt < MAG_SIZE / 2) {
+		void *page = pool_take (pool, 1);
+
+		if (page == NULL)
+			break;
+		pool->mag.pages[pool->mag.cnt++] = page;
+	}
+}
+
+/* Returns the pages in MAG, one of POOL's magazines, to POOL's
+   buddy lists until only KEEP remain, oldest first.  POOL's lock
+   must be held. */
+static void
+mag_drain (struct pool *pool, struct magazine *mag, size_t keep) {
+	size_t i, drop;
+
+	if (mag->cnt <= keep)
+		return;
+	drop = mag->cnt - keep;
+	for (i = 0; i < drop; i++)
+		pool_give (pool, mag->pages[i], 1);
+	memmove (mag->pages, mag->pages + drop, keep * sizeof *mag->pages);
+	mag->cnt = keep;
+}
+
+/* Zeroes the PAGE_CNT pages starting at PAGES, eight bytes at a
+   time. */
+static void
+zero_pages (void *pages, size_t page_cnt) {
+	size_t cnt = page_cnt * PGSIZE / sizeof (uint64_t);
+
+	asm volatile ("rep stosq" : "+D" (pages), "+c" (cnt) : "a" (0) : "memory");
+}
+
+/* Adds the block of 2**ORDER pages at index PAGE_IDX of POOL to
+   the free list for ORDER. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order) {
+	pool->pages[page_idx].free_order = order + 1;
+	pool->free_cnt[order]++;
+	list_push_front (&pool->free_lists[order], &pool->pages[page_idx].elem);
+}
+
+/* Removes the block at index PAGE_IDX of POOL, which heads a free
+   block of 2**ORDER pages, from its free list. */
+static void
+pop_block (struct pool *pool, size_t page_idx, int order) {
+	pool->pages[page_idx].free_order = 0;
+	pool->free_cnt[order]--;
+	list_remove (&pool->pages[page_idx].elem);
+}
+
+/* Frees the block of 2**ORDER pages at index PAGE_IDX of POOL,
+   merging it with its buddy for as long as the buddy is a free
+   block of the same size. */
+static void
+buddy_insert (struct pool *pool, size_t page_idx, int order) {
+	size_t base_no = pg_no (pool->base);
+	size_t pool_size = bitmap_size (pool->used_map);
+
+	while (order < MAX_ORDER) {
+		/* Buddies differ in bit ORDER of their physical page
+		   numbers.  A buddy below the pool wraps around to a
+		   huge index. */
+		size_t buddy = ((base_no + page_idx) ^ ((size_t) 1 << order)) - base_no;
+
+		if (buddy >= pool_size || pool->pages[buddy].free_order != order + 1)
+			break;
+		pop_block (pool, buddy, order);
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	push_block (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages starting at index PAGE_IDX of POOL,
+   as the largest aligned blocks that fit.  POOL's lock must be
+   held, or the pool must not be in use yet. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t base_no = pg_no (pool->base);
+
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < MAX_ORDER
+				&& ((base_no + page_idx) & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_insert (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Takes the PAGE_CNT pages starting at index PAGE_IDX of POOL,
+   which must all be free, out of the buddy lists.  Each free block
+   that overlaps them is taken whole and the parts of it outside
+   the range are freed again.  POOL's lock must be held. */
+static void
+buddy_claim (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t base_no = pg_no (pool->base);
+	size_t end = page_idx + page_cnt;
+
+	while (page_idx < end) {
+		size_t head, size;
+		int order;
+
+		/* Find the free block that holds PAGE_IDX. */
+		for (order = 0; ; order++) {
+			ASSERT (order <= MAX_ORDER);
+			head = ((base_no + page_idx) & ~(((size_t) 1 << order) - 1))
+				- base_no;
+			if (head <= page_idx && pool->pages[head].free_order == order + 1)
+				break;
+		}
+		size = (size_t) 1 << order;
+		pop_block (pool, head, order);
+
+		buddy_free (pool, head, page_idx - head);
+		if (head + size > end) {
+			buddy_free (pool, end, head + size - end);
+			size = end - head;
+		}
+		page_idx = head + size;
+	}
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL, aligned to PAGE_CNT
+   rounded up to a power of two, and returns the index of the
+   first, or BITMAP_ERROR if no free block is big enough.  POOL's
+   lock must be held. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	int want = 0, order;
+	size_t page_idx;
+
+	while (((size_t) 1 << want) < page_cnt)
+		if (++want > MAX_ORDER)
+			return BITMAP_ERROR;
+
+	for (order = want; order <= MAX_ORDER; order++)
+		if (!list_empty (&pool->free_lists[order]))
+			break;
+	if (order > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = list_entry (list_front (&pool->free_lists[order]),
+			struct page_info, elem) - pool->pages;
+	pop_block (pool, page_idx, order);
+
+	/* Split down to the size wanted, freeing the upper halves,
+	   then give back the pages past PAGE_CNT. */
+	while (order > want) {
+		order--;
+		push_block (pool, page_idx + ((size_t) 1 << order), order);
+	}
+	buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+	return page_idx;
+}
+
+/* Prints the free blocks of each order in POOL, named NAME. */
+static void
+print_pool_stats (const char *name, struct pool *pool) {
+	size_t free_cnt[MAX_ORDER + 1];
+	size_t free_pages = 0, mag_cnt, zeroed_cnt;
+	uint64_t zero_hits, zero_misses;
+	int order, top = 0;
+
+	spinlock_acquire (&pool->lock);
+	memcpy (free_cnt, pool->free_cnt, sizeof free_cnt);
+	mag_cnt = pool->mag.cnt;
+	zeroed_cnt = pool->zeroed.cnt;
+	zero_hits = pool->zero_hits;
+	zero_misses = pool->zero_misses;
+	spinlock_release (&pool->lock);
+
+	for (order = 0; order <= MAX_ORDER; order++)
+		if (free_cnt[order] != 0) {
+			free_pages += free_cnt[order] << order;
+			top = order;
+		}
+	printf ("Palloc: %s pool %zu free pages (%zu cached, %zu zeroed), "
+			"free blocks by order:", name, free_pages + mag_cnt + zeroed_cnt,
+			mag_cnt, zeroed_cnt);
+	for (order = 0; order <= top; order++)
+		printf (" %zu", free_cnt[order]);
+	printf ("\n");
+	printf ("Palloc: %s pool %"PRIu64" zeroed allocations, %"PRIu64" hits, "
+			"%"PRIu64" misses\n", name, zero_hits + zero_misses, zero_hits,
+			zero_misses);
+}
+
+/* Prints page allocator statistics: how the free memory of each
+   pool is broken up into blocks, as a measure of fragmentation. */
+void
+palloc_print_stats (void) {
+	print_pool_stats ("kernel", &kernel_pool);
+	print_pool_stats ("user", &user_pool);
+}
@@ -0,0 +1,245 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+
+#define NSEC_PER_SEC 1000000000LL
+
+/* Most frames recorded per sample, counting the interrupted RIP. */
+#define PROFILE_DEPTH 16
+
+/* Pages of memory for the histogram. */
+#define PROFILE_PAGES 64
+
+/* One distinct call stack and the number of times it was seen. */
+struct profile_entry {
+	uint64_t count;                     /* Samples of this stack. */
+	uintptr_t pcs[PROFILE_DEPTH];       /* Innermost first; 0 ends. */
+};
+
+int profile_hz;
+
+static struct profile_entry *entries;   /* Open-addressed hash table. */
+static size_t entry_cnt;                /* Capacity of ENTRIES. */
+static uint64_t sample_cnt;             /* Samples recorded. */
+static uint64_t dropped_cnt;            /* Samples lost to a full table. */
+static bool sampling;                   /* Recording samples now? */
+
+/* Samples are taken on the profiler's own schedule, once every
+   NSEC_PER_SEC / PROFILE_HZ ns, at the first timer interrupt at
+   or after PROFILE_NEXT.  The sample itself is taken by
+   profile_sample(), called from the timer interrupt, which has
+   the frame.  Other timer interrupts, such as the other ticks
+   when PROFILE_HZ is below TIMER_FREQ or the expiry of an
+   unrelated hrtimer, are not sampled.  If PROFILE_HZ is above
+   TIMER_FREQ, PROFILE_TIMER raises interrupts between ticks. */
+static struct hrtimer profile_timer;
+static int64_t profile_next;
+
+static void profile_timer_func (void *aux);
+
+/* Allocates the histogram and starts sampling, if the
+   "-profile" option was given.  Must be called after
+   timer_calibrate(). */
+void
+profile_init (void) {
+	if (profile_hz <= 0)
+		return;
+
+	entries = palloc_get_multiple (PAL_ZERO, PROFILE_PAGES);
+	if (entries == NULL) {
+		printf ("profile: not enough memory, profiling disabled\n");
+		profile_hz = 0;
+		return;
+	}
+	entry_cnt = PROFILE_PAGES * PGSIZE / sizeof *entries;
+
+	printf ("profile: sampling at %d Hz\n", profile_hz);
+	sampling = true;
+	profile_next = timer_ns () + NSEC_PER_SEC / profile_hz;
+	if (profile_hz > TIMER_FREQ) {
+		hrtimer_setup (&profile_timer, profile_timer_func, NULL);
+		hrtimer_arm (&profile_timer, profile_next);
+	}
+}
+
+/* Moves PROFILE_NEXT past NOW.  Samples that are overdue by
+   more than one period are skipped, not taken in a burst. */
+static void
+profile_advance (int64_t now) {
+	while (profile_next <= now)
+		profile_next += NSEC_PER_SEC / profile_hz;
+}
+
+/* Re-arms the profiling timer for the next sample.  Normally
+   profile_sample() has already taken the sample that was due and
+   moved PROFILE_NEXT on. */
+static void
+profile_timer_func (void *aux UNUSED) {
+	if (!sampling)
+		return;
+	profile_advance (timer_ns ());
+	hrtimer_arm (&profile_timer, profile_next);
+}
+
+/* Records the code that timer interrupt F interrupted. */
+void
+profile_sample (const struct intr_frame *f) {
+	uintptr_t pcs[PROFILE_DEPTH];
+	uint64_t hash = 14695981039346656037ULL;
+	size_t depth = 0, i;
+	int64_t now;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!sampling)
+		return;
+	now = timer_ns ();
+	if (now < profile_next)
+		return;
+	profile_advance (now);
+
+	/* Walk the interrupted kernel stack by its frame pointers,
+	   trusting them only while they climb within one thread's
+	   page.  User stacks are not walked. */
+	pcs[depth++] = f->rip;
+	if (f->cs == SEL_KCSEG) {
+		uintptr_t *fp = (uintptr_t *) f->R.rbp;
+		uint8_t *page = pg_round_down (fp);
+
+		while (depth < PROFILE_DEPTH && is_kernel_vaddr (fp)
+				&& (uintptr_t) fp % sizeof *fp == 0
+				&& pg_round_down (fp) == page
+				&& (uint8_t *) (fp + 2) <= page + PGSIZE
+				&& fp[1] != 0) {
+			pcs[depth++] = fp[1];
+			if ((uintptr_t *) fp[0] <= fp)
+				break;
+			fp = (uintptr_t *) fp[0];
+		}
+	}
+	if (depth < PROFILE_DEPTH)
+		memset (pcs + depth, 0, (PROFILE_DEPTH - depth) * sizeof *pcs);
+
+	/* FNV-1a over the stack picks the first slot to probe. */
+	for (i = 0; i < depth; i++)
+		hash = (hash ^ pcs[i]) * 1099511628211ULL;
+
+	sample_cnt++;
+	for (i = 0; i < entry_cnt; i++) {
+		struct profile_entry *e = &entries[(hash + i) % entry_cnt];
+
+		if (e->count == 0)
+			memcpy (e->pcs, pcs, sizeof pcs);
+		else if (memcmp (e->pcs, pcs, sizeof pcs))
+			continue;
+		e->count++;
+		return;
+	}
+	dropped_cnt++;
+}
+
+/* Stops taking samples, so that the histogram holds still while
+   it is written out. */
+void
+profile_stop (void) {
+	enum intr_level old_level = intr_disable ();
+
+	sampling = false;
+	if (profile_hz > TIMER_FREQ)
+		hrtimer_cancel (&profile_timer);
+	intr_set_level (old_level);
+}
+
+/* Longest line format_entry() can produce, with its null
+   terminator. */
+#define PROFILE_LINE_MAX (20 + PROFILE_DEPTH * 17 + 2)
+
+/* Formats the line for entry E into LINE and returns its length.
+   A line is the sample count followed by the stack, in hex,
+   innermost frame first. */
+static size_t
+format_entry (const struct profile_entry *e, char line[PROFILE_LINE_MAX]) {
+	size_t len = snprintf (line, PROFILE_LINE_MAX, "%"PRIu64, e->count);
+	size_t i;
+
+	for (i = 0; i < PROFILE_DEPTH && e->pcs[i] != 0; i++)
+		len += snprintf (line + len, PROFILE_LINE_MAX - len,
+				" %"PRIx64, (uint64_t) e->pcs[i]);
+	len += snprintf (line + len, PROFILE_LINE_MAX - len, "\n");
+	return len;
+}
+
+/* Stops sampling and prints the histogram to the console. */
+void
+profile_print (void) {
+	char line[PROFILE_LINE_MAX];
+	size_t i;
+
+	if (entries == NULL)
+		return;
+	profile_stop ();
+	for (i = 0; i < entry_cnt; i++)
+		if (entries[i].count != 0) {
+			format_entry (&entries[i], line);
+			printf ("%s", line);
+		}
+}
+
+#ifdef FILESYS
+/* Stops sampling and writes the histogram to FILE_NAME in the
+   file system, creating it, in the format printed by
+   profile_print().  The "get" action can then copy it out to
+   the scratch disk. */
+void
+profile_save (const char *file_name) {
+	char line[PROFILE_LINE_MAX];
+	struct file *file;
+	off_t size = 0;
+	size_t i;
+
+	if (entries == NULL)
+		PANIC ("profile: profiling is not enabled (use -profile)");
+	profile_stop ();
+
+	/* The file system wants to know the size up front. */
+	for (i = 0; i < entry_cnt; i++)
+		if (entries[i].count != 0)
+			size += format_entry (&entries[i], line);
+
+	if (!filesys_create (file_name, size))
+		PANIC ("%s: create failed", file_name);
+	file = filesys_open (file_name);
+	if (file == NULL)
+		PANIC ("%s: open failed", file_name);
+	for (i = 0; i < entry_cnt; i++)
+		if (entries[i].count != 0) {
+			off_t len = format_entry (&entries[i], line);
+
+			if (file_write (file, line, len) != len)
+				PANIC ("%s: write failed", file_name);
+		}
+	file_close (file);
+	printf ("profile: saved %"PRIu64" samples to '%s'\n",
+			sample_cnt - dropped_cnt, file_name);
+}
+#endif
+
+/* Prints profiler statistics, if profiling was enabled. */
+void
+profile_print_stats (void) {
+	if (profile_hz > 0)
+		printf ("Profile: %"PRIu64" samples, %"PRIu64" dropped\n",
+				sample_cnt, dropped_cnt);
+}
@@ -0,0 +1,358 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* An object cache allocator.
+
+   malloc() rounds every request up to a power of 2 and keeps its
+   free blocks on lists, so odd-sized objects waste up to half of
+   their block.  Objects that the kernel creates and destroys
+   often, such as inodes and open files, get a cache of their own
+   instead.
+
+   A cache carves single pages, called "slabs", into objects of
+   exactly its size.  The slab header at the start of the page
+   keeps a stack of the indexes of its free objects, so nothing is
+   ever written into a free object: an object built by the cache's
+   constructor stays built across free and reuse.  Slabs sit on
+   one of three lists, by whether they are partly used, fully used
+   or unused.  One unused slab is kept around to absorb bursts;
+   the others go back to the page allocator.
+
+   Space left over at the end of a slab is used for "coloring":
+   each new slab shifts its objects by one more alignment unit, so
+   that objects at the same index in different slabs do not all
+   compete for the same cache lines.
+
+   In front of the slabs, each cache keeps a small stack of
+   recently freed objects, which are still warm in the CPU cache.
+   Most allocations and frees only push or pop this stack with
+   interrupts off, which is enough while a single CPU allocates
+   memory (the others are parked). */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab4c7e
+
+/* Most objects kept on a cache's free stack. */
+#define FREE_STACK_SIZE 16
+
+/* Object cache. */
+struct kmem_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t obj_size;            /* Object size, a multiple of ALIGN. */
+	size_t align;               /* Object alignment, a power of 2. */
+	kmem_ctor_func *ctor;       /* Constructor, or a null pointer. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	size_t first_ofs;           /* Offset of the first uncolored object. */
+	size_t color_max;           /* Largest color offset. */
+	size_t color_next;          /* Color offset of the next new slab. */
+
+	struct spinlock lock;       /* Guards the slab lists. */
+	struct list partial;        /* Slabs with used and free objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list empty;          /* Slabs with no used objects. */
+
+	size_t stack_cnt;           /* Objects in STACK. */
+	void *stack[FREE_STACK_SIZE]; /* Recently freed objects. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs owned. */
+	size_t used_cnt;            /* Objects handed out. */
+	uint64_t alloc_cnt;         /* Calls to kmem_cache_alloc(). */
+	uint64_t free_cnt;          /* Calls to kmem_cache_free(). */
+
+	struct list_elem elem;      /* Element in all_caches. */
+};
+
+/* Slab header, at the start of its page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of the cache's lists. */
+	uint8_t *objs;              /* First object. */
+	size_t free_cnt;            /* Number of entries in FREE. */
+	uint16_t free[];            /* Indexes of free objects. */
+};
+
+/* All caches, for statistics.  Caches are never destroyed, so
+   the list only grows. */
+static struct list all_caches;
+static struct spinlock all_caches_lock;
+
+static void *slab_take (struct kmem_cache *);
+static void slab_put (struct kmem_cache *, void *obj);
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *obj);
+
+/* Initializes the object cache allocator. */
+void
+kmem_init (void) {
+	list_init (&all_caches);
+	spinlock_init (&all_caches_lock);
+}
+
+/* Creates and returns a cache of objects of SIZE bytes each,
+   aligned to ALIGN bytes, which must be a power of 2 (0 means
+   the alignment of a pointer).  If CTOR is nonnull, it is run on
+   each object when the object's slab is made, and objects must be
+   returned to the cache in their constructed state.  NAME is used
+   only for statistics and must outlive the cache.
+
+   Caches are made at initialization time, so this panics the
+   kernel if memory is short. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+		kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n, used;
+
+	if (align == 0)
+		align = sizeof (void *);
+	ASSERT ((align & (align - 1)) == 0);
+	ASSERT (size > 0);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		PANIC ("kmem_cache_create: out of memory");
+	c->name = name;
+	c->obj_size = ROUND_UP (size, align);
+	c->align = align;
+	c->ctor = ctor;
+
+	/* Fit as many objects as possible after the header and its
+	   stack of free indexes. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+				align) + n * c->obj_size > PGSIZE)
+		n--;
+	if (n == 0)
+		PANIC ("kmem_cache_create: %zu-byte objects do not fit a slab", size);
+	c->objs_per_slab = n;
+	c->first_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+			align);
+	used = c->first_ofs + n * c->obj_size;
+	c->color_max = ROUND_DOWN (PGSIZE - used, align);
+	c->color_next = 0;
+
+	spinlock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->stack_cnt = 0;
+	c->slab_cnt = 0;
+	c->used_cnt = 0;
+	c->alloc_cnt = 0;
+	c->free_cnt = 0;
+
+	spinlock_acquire (&all_caches_lock);
+	list_push_back (&all_caches, &c->elem);
+	spinlock_release (&all_caches_lock);
+	return c;
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	enum intr_level old_level;
+	void *obj = NULL;
+
+	old_level = intr_disable ();
+	if (c->stack_cnt > 0) {
+		obj = c->stack[--c->stack_cnt];
+		c->used_cnt++;
+		c->alloc_cnt++;
+	}
+	intr_set_level (old_level);
+
+	if (obj == NULL) {
+		spinlock_acquire (&c->lock);
+		obj = slab_take (c);
+		if (obj != NULL) {
+			c->used_cnt++;
+			c->alloc_cnt++;
+		}
+		spinlock_release (&c->lock);
+	}
+	return obj;
+}
+
+/* Returns OBJ, which must have come from cache C, to C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	enum intr_level old_level;
+	bool pushed = false;
+
+	if (obj == NULL)
+		return;
+	obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it must keep its constructed state. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	old_level = intr_disable ();
+#ifndef NDEBUG
+	for (size_t i = 0; i < c->stack_cnt; i++)
+		ASSERT (c->stack[i] != obj);
+#endif
+	if (c->stack_cnt < FREE_STACK_SIZE) {
+		c->stack[c->stack_cnt++] = obj;
+		c->used_cnt--;
+		c->free_cnt++;
+		pushed = true;
+	}
+	intr_set_level (old_level);
+
+	if (!pushed) {
+		/* The stack is full.  Give its older half back to the
+		   slabs, along with OBJ. */
+		size_t i, half = FREE_STACK_SIZE / 2;
+
+		spinlock_acquire (&c->lock);
+		for (i = 0; i < half; i++)
+			slab_put (c, c->stack[i]);
+		memmove (c->stack, c->stack + half,
+				(c->stack_cnt - half) * sizeof *c->stack);
+		c->stack_cnt -= half;
+		slab_put (c, obj);
+		c->used_cnt--;
+		c->free_cnt++;
+		spinlock_release (&c->lock);
+	}
+}
+
+/* Prints allocation counts and slab utilization for each cache. */
+void
+kmem_print_stats (void) {
+	struct list_elem *e;
+
+	for (e = list_begin (&all_caches); e != list_end (&all_caches);
+			e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+		size_t slab_cnt, used_cnt;
+		uint64_t alloc_cnt, free_cnt;
+
+		spinlock_acquire (&c->lock);
+		slab_cnt = c->slab_cnt;
+		used_cnt = c->used_cnt;
+		alloc_cnt = c->alloc_cnt;
+		free_cnt = c->free_cnt;
+		spinlock_release (&c->lock);
+
+		printf ("Slab: %s: %zu-byte objects, %zu in use, %zu slabs "
+				"(%zu%% used), %"PRIu64" allocs, %"PRIu64" frees\n",
+				c->name, c->obj_size, used_cnt, slab_cnt,
+				slab_cnt ? used_cnt * 100 / (slab_cnt * c->objs_per_slab) : 0,
+				alloc_cnt, free_cnt);
+	}
+}
+
+/* Takes a free object out of one of C's slabs, making a new slab
+   if none has room.  Returns a null pointer if memory is not
+   available.  C's lock must be held. */
+static void *
+slab_take (struct kmem_cache *c) {
+	struct slab *s;
+
+	if (list_empty (&c->partial)) {
+		if (!list_empty (&c->empty))
+			list_push_front (&c->partial, list_pop_front (&c->empty));
+		else {
+			s = slab_create (c);
+			if (s == NULL)
+				return NULL;
+			list_push_front (&c->partial, &s->elem);
+		}
+	}
+
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	ASSERT (s->free_cnt > 0);
+	if (--s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	return s->objs + s->free[s->free_cnt] * c->obj_size;
+}
+
+/* Returns OBJ to its slab in C.  Keeps one unused slab and frees
+   any other.  C's lock must be held. */
+static void
+slab_put (struct kmem_cache *c, void *obj) {
+	struct slab *s = obj_to_slab (c, obj);
+
+	ASSERT (s->free_cnt < c->objs_per_slab);
+	s->free[s->free_cnt++] = ((uint8_t *) obj - s->objs) / c->obj_size;
+	if (s->free_cnt == 1 && c->objs_per_slab > 1) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	} else if (s->free_cnt == c->objs_per_slab) {
+		list_remove (&s->elem);
+		if (list_empty (&c->empty))
+			list_push_front (&c->empty, &s->elem);
+		else {
+			s->magic = 0;
+			palloc_free_page (s);
+			c->slab_cnt--;
+		}
+	}
+}
+
+/* Makes a new slab for C, with all of its objects free and
+   constructed.  Returns a null pointer if memory is not
+   available.  C's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	size_t i;
+
+	if (s == NULL)
+		return NULL;
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->objs = (uint8_t *) s + c->first_ofs + c->color_next;
+	c->color_next += c->align;
+	if (c->color_next > c->color_max)
+		c->color_next = 0;
+
+	/* Hand out low indexes first. */
+	s->free_cnt = c->objs_per_slab;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->free[i] = c->objs_per_slab - 1 - i;
+		if (c->ctor != NULL)
+			c->ctor (s->objs + i * c->obj_size);
+	}
+	c->slab_cnt++;
+	return s;
+}
+
+/* Returns the slab that OBJ, which must come from C, is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid and belongs to C. */
+	ASSERT (s != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+
+	/* Check that OBJ is properly placed in the slab. */
+	ASSERT ((uint8_t *) obj >= s->objs);
+	ASSERT (((uint8_t *) obj - s->objs) % c->obj_size == 0);
+	ASSERT (((uint8_t *) obj - s->objs) / c->obj_size < c->objs_per_slab);
+
+	return s;
+}
@@ -0,0 +1,226 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/apic.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "userprog/tss.h"
+#endif
+
+/* Multiprocessor support.
+
+   The bootstrap processor (BSP) copies the real-mode trampoline
+   in ap-start.S to LOADER_AP_TRAMPOLINE, then broadcasts the
+   INIT-SIPI-SIPI sequence through its local APIC.  Each
+   application processor (AP) switches itself to long mode, loads
+   the kernel page table, claims a slot in cpus[] and starts on
+   the stack of the idle thread made for it, calling
+   smp_ap_main().  There it sets up its own IDT, TSS, system call
+   MSRs and local APIC timer, and becomes its idle thread, which
+   takes threads from the run queues like any other CPU.
+
+   Each CPU has its own run queue (see thread.c).  The kernel
+   relies on turning interrupts off for mutual exclusion almost
+   everywhere, so intr_disable() also takes a global interrupt
+   lock, held for as long as interrupts stay off (see
+   interrupt.c).  Code that runs with interrupts on, including
+   all user code, runs on every CPU at once. */
+
+struct cpu cpus[CPU_MAX] = { [0] = { .online = true } };
+int smp_cpu_cnt = 1;
+
+/* Shared with ap-start.S. */
+extern const char ap_trampoline[], ap_trampoline_end[];
+uint64_t ap_cr3;                        /* Physical address of base_pml4. */
+uint64_t ap_stacks[CPU_MAX];            /* Initial stack tops for APs. */
+int ap_stack_cnt;                       /* Number of entries in ap_stacks[]. */
+int ap_next = 1;                        /* Next cpus[] index to hand out. */
+
+void smp_ap_main (int idx) NO_RETURN;
+
+static intr_handler_func resched_interrupt;
+static intr_handler_func tlb_interrupt;
+
+/* Records the BSP's local APIC ID and, if more than one CPU was
+   requested with "-smp=N", starts the application processors
+   and waits up to a second for them to come online. */
+void
+smp_init (void) {
+	int i;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	if (intr_apic_enabled ())
+		cpus[0].lapic_id = lapic_id ();
+	if (smp_cpu_cnt <= 1)
+		return;
+	if (!intr_apic_enabled ()) {
+		printf ("smp: no local APIC, running on one CPU\n");
+		smp_cpu_cnt = 1;
+		return;
+	}
+
+	intr_register_int (LAPIC_RESCHED_VEC, 0, INTR_OFF, resched_interrupt,
+			"Reschedule IPI");
+	intr_register_int (LAPIC_TLB_VEC, 0, INTR_OFF, tlb_interrupt,
+			"TLB shootdown IPI");
+
+	/* Each AP starts out on the stack of its idle thread. */
+	for (i = 1; i < smp_cpu_cnt; i++) {
+		cpus[i].id = i;
+		ap_stacks[i] = (uint64_t) thread_create_idle (&cpus[i]) + PGSIZE;
+	}
+	ap_stack_cnt = smp_cpu_cnt;
+	ap_cr3 = vtop (base_pml4);
+
+	memcpy (ptov (LOADER_AP_TRAMPOLINE), ap_trampoline,
+			ap_trampoline_end - ap_trampoline);
+
+	/* The universal start-up algorithm.
+	   See [IA32-v3a] section 8.4.4.1 "Typical BSP Initialization
+	   Sequence". */
+	lapic_send_init ();
+	timer_msleep (10);
+	lapic_send_startup (LOADER_AP_TRAMPOLINE);
+	timer_usleep (200);
+	lapic_send_startup (LOADER_AP_TRAMPOLINE);
+
+	for (i = 0; i < 100 && smp_online_cnt () < smp_cpu_cnt; i++)
+		timer_msleep (10);
+
+	printf ("smp: %d of %d CPUs online\n", smp_online_cnt (), smp_cpu_cnt);
+}
+
+/* Returns the number of CPUs that are running threads. */
+int
+smp_online_cnt (void) {
+	int i, cnt = 0;
+
+	for (i = 0; i < CPU_MAX; i++)
+		if (cpus[i].online)
+			cnt++;
+	return cnt;
+}
+
+/* Returns the running CPU's entry in cpus[].  Every CPU always
+   runs on the stack of some thread, and the scheduler keeps the
+   running thread's `cpu' member pointing to the CPU it runs on,
+   so this finds the thread the same way as thread_current(). */
+struct cpu *
+cpu_current (void) {
+	struct thread *t = pg_round_down (rrsp ());
+
+	/* Until thread_init(), the BSP runs alone, and not as a thread. */
+	if (cpus[0].curr == NULL)
+		return &cpus[0];
+	return t->cpu;
+}
+
+/* Returns true if running on the bootstrap processor. */
+bool
+cpu_is_bsp (void) {
+	return cpu_current ()->id == 0;
+}
+
+/* Asks CPU C to check whether its running thread should be
+   preempted.  Does nothing if C is the calling CPU. */
+void
+smp_send_resched (struct cpu *c) {
+	if (c != cpu_current ())
+		lapic_send_ipi (c->lapic_id, LAPIC_RESCHED_VEC);
+}
+
+/* Makes every other CPU that runs on the page table at physical
+   address CR3 flush its TLB, and waits until they all have.
+   Called after a present mapping in that page table is removed
+   or changed.
+
+   The waiting is done with the interrupt lock held, so the other
+   CPUs must be able to answer without it: they do so in the IPI
+   handler, before intr_handler() takes the lock, or while
+   spinning on the lock in intr_disable(). */
+void
+smp_tlb_shootdown (uint64_t cr3) {
+	enum intr_level old_level;
+	struct cpu *self;
+	int i;
+
+	if (smp_cpu_cnt == 1)
+		return;
+	old_level = intr_disable ();
+	self = cpu_current ();
+	for (i = 0; i < CPU_MAX; i++) {
+		struct cpu *c = &cpus[i];
+		if (c != self && c->online && c->cr3 == cr3) {
+			c->tlb_flush = true;
+			lapic_send_ipi (c->lapic_id, LAPIC_TLB_VEC);
+		}
+	}
+	for (i = 0; i < CPU_MAX; i++)
+		while (cpus[i].tlb_flush)
+			asm volatile ("pause");
+	intr_set_level (old_level);
+}
+
+/* Flushes the running CPU's TLB if smp_tlb_shootdown() asked it
+   to.  Runs with interrupts off, with or without the interrupt
+   lock. */
+void
+smp_tlb_flush_pending (void) {
+	struct cpu *c = cpu_current ();
+
+	if (c->tlb_flush) {
+		lcr3 (rcr3 ());
+		__atomic_store_n (&c->tlb_flush, false, __ATOMIC_RELEASE);
+	}
+}
+
+/* Reschedule IPI handler. */
+static void
+resched_interrupt (struct intr_frame *f UNUSED) {
+	thread_try_preemption ();
+}
+
+/* TLB shootdown IPI handler.  Called by intr_handler() without
+   the interrupt lock. */
+static void
+tlb_interrupt (struct intr_frame *f UNUSED) {
+	smp_tlb_flush_pending ();
+}
+
+/* Entry point of application processor IDX, called from
+   ap-start.S on the stack of its idle thread, with interrupts
+   disabled. */
+void
+smp_ap_main (int idx) {
+	struct cpu *c = &cpus[idx];
+
+	/* Interrupts are off, so we must hold the interrupt lock
+	   before touching anything shared. */
+	intr_lock_acquire ();
+	ASSERT (cpu_current () == c);
+	thread_init_ap ();
+
+#ifdef USERPROG
+	tss_init ();
+	gdt_init ();
+#endif
+	intr_init_ap ();
+#ifdef USERPROG
+	syscall_init ();
+#endif
+	lapic_init ();
+	c->lapic_id = lapic_id ();
+	timer_init_ap ();
+
+	thread_start_ap ();
+}
@@ -0,0 +1,83 @@
+#include "threads/softirq.h"
+#include <debug.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/smp.h"
+
+/* Handler for each softirq. */
+static softirq_func *softirq_handlers[SOFTIRQ_CNT];
+
+/* Bit N is set while softirq N is raised and has not run yet. */
+static volatile uint32_t softirq_pending;
+
+/* True while softirq_run() is running handlers on some CPU.
+   Each CPU also records whether it is the one, in struct cpu. */
+static bool softirq_active;
+
+/* Sets HANDLER to run whenever softirq NR is raised. */
+void
+softirq_register (enum softirq_nr nr, softirq_func *handler) {
+	ASSERT (nr < SOFTIRQ_CNT);
+	ASSERT (softirq_handlers[nr] == NULL);
+
+	softirq_handlers[nr] = handler;
+}
+
+/* Marks softirq NR to run.  Usually called from an interrupt
+   handler, in which case NR runs when the handler returns.
+   Raising a softirq that is already pending has no further
+   effect. */
+void
+softirq_raise (enum softirq_nr nr) {
+	enum intr_level old_level;
+
+	ASSERT (nr < SOFTIRQ_CNT);
+
+	old_level = intr_disable ();
+	softirq_pending |= 1u << nr;
+	intr_set_level (old_level);
+}
+
+/* Runs pending softirqs, until none is left, with interrupts
+   on.  Must be called with interrupts off, and returns with them
+   off.  Does nothing when softirqs are already running, so that
+   an interrupt arriving meanwhile leaves its softirqs to the
+   softirq_run() it interrupted.
+
+   Called by intr_handler() at the end of each external interrupt,
+   and by the idle thread after it catches up on ticks skipped in
+   tickless mode.
+
+   Softirqs run on one CPU at a time, so that no handler runs
+   twice at once.  If they already run on another CPU, that CPU
+   picks up the ones raised here too. */
+void
+softirq_run (void) {
+	struct cpu *c = cpu_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (softirq_active)
+		return;
+
+	softirq_active = c->in_softirq = true;
+	while (softirq_pending != 0) {
+		uint32_t pending = softirq_pending;
+		int nr;
+
+		softirq_pending = 0;
+		intr_enable ();
+		for (nr = 0; nr < SOFTIRQ_CNT; nr++)
+			if ((pending & (1u << nr)) && softirq_handlers[nr] != NULL)
+				softirq_handlers[nr] ();
+		intr_disable ();
+	}
+	softirq_active = c->in_softirq = false;
+}
+
+/* Returns true while softirq handlers are running on this CPU. */
+bool
+softirq_context (void) {
+	return cpu_current ()->in_softirq;
+}
@@ -31,6 +31,108 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef LOCKSTAT
+#include <inttypes.h>
+#include "devices/timer.h"
+
+/* The functions themselves, not the macros that add statistics
+   at each call site. */
+#undef sema_init
+#undef lock_init
+
+static void lockstat_acquired (struct semaphore *, uint64_t wait_start);
+static void lockstat_released (struct lock *);
+#endif
+
+/* Arrival counter for wait queue FIFO order. */
+static uint64_t waitq_seq;
+
+static bool waitq_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+
+/* Initializes wait queue Q as empty. */
+void
+waitq_init (struct waitq *q) {
+	ASSERT (q != NULL);
+
+	heap_init (&q->heap, waitq_less, NULL);
+}
+
+/* Returns true if no thread is waiting in Q. */
+bool
+waitq_empty (const struct waitq *q) {
+	return heap_empty (&q->heap);
+}
+
+/* Returns the highest-priority thread in Q without removing it,
+   or a null pointer if Q is empty. */
+struct thread *
+waitq_top (const struct waitq *q) {
+	struct heap_elem *e = heap_top (&q->heap);
+
+	if (e == NULL)
+		return NULL;
+	return heap_entry (e, struct thread, wq_elem.elem);
+}
+
+/* Adds thread T to Q.  Interrupts must be off. */
+void
+waitq_push (struct waitq *q, struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->waitq == NULL);
+
+	t->wq_elem.seq = waitq_seq++;
+	t->waitq = q;
+	heap_push (&q->heap, &t->wq_elem.elem);
+}
+
+/* Removes and returns the highest-priority thread in Q, which
+   must not be empty.  Interrupts must be off. */
+struct thread *
+waitq_pop (struct waitq *q) {
+	struct thread *t;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!waitq_empty (q));
+
+	t = heap_entry (heap_pop (&q->heap), struct thread, wq_elem.elem);
+	t->waitq = NULL;
+	return t;
+}
+
+/* Removes thread T from the wait queue it is in.  Interrupts
+   must be off. */
+void
+waitq_remove (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->waitq != NULL);
+
+	heap_remove (&t->waitq->heap, &t->wq_elem.elem);
+	t->waitq = NULL;
+}
+
+/* Restores the order of T's wait queue, if any, after T's
+   priority has changed.  T keeps its place among threads of its
+   new priority.  Interrupts must be off. */
+void
+waitq_reprioritize (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->waitq != NULL)
+		heap_update (&t->waitq->heap, &t->wq_elem.elem);
+}
+
+/* Returns true if A should leave its wait queue before B. */
+static bool
+waitq_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct waitq_elem *a = heap_entry (a_, struct waitq_elem, elem);
+	const struct waitq_elem *b = heap_entry (b_, struct waitq_elem, elem);
+	int pa = heap_entry (a, struct thread, wq_elem)->priority;
+	int pb = heap_entry (b, struct thread, wq_elem)->priority;
+
+	return pa > pb || (pa == pb && a->seq < b->seq);
+}
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -40,13 +142,20 @@
    decrement it.
 
    - up or "V": increment the value (and wake up one waiting
-   thread, if any). */
+   thread, if any).
+
+   Like the rest of this file, semaphores are made atomic by
+   turning interrupts off, which also takes the global interrupt
+   lock (see interrupt.c), so they are atomic across CPUs too. */
 void
 sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	waitq_init (&sema->waiters);
+#ifdef LOCKSTAT
+	sema->stat = NULL;
+#endif
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -60,19 +169,28 @@ sema_init (struct semaphore *sema, unsigned value) {
 void
 sema_down (struct semaphore *sema) {
 	enum intr_level old_level;
+#ifdef LOCKSTAT
+	uint64_t wait_start = 0;
+#endif
 
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
+#ifdef LOCKSTAT
+		if (wait_start == 0)
+			wait_start = timer_cycles ();
+#endif
 		// for priority scheduling
-		// insertion strategy should be modified properly : to wake up thread with higher priority first
-		list_insert_ordered (&sema->waiters, &thread_current ()->elem, &cmp_priority_greater, NULL);
-		// list_push_back (&sema->waiters, &thread_current ()->elem);
+		// the wait queue keeps waiters ordered by priority, so the highest one is woken first
+		waitq_push (&sema->waiters, thread_current ());
 		thread_block ();
 	}
 	sema->value--;
+#ifdef LOCKSTAT
+	lockstat_acquired (sema, wait_start);
+#endif
 	intr_set_level (old_level);
 }
 
@@ -93,6 +211,9 @@ sema_try_down (struct semaphore *sema) {
 	{
 		sema->value--;
 		success = true;
+#ifdef LOCKSTAT
+		lockstat_acquired (sema, 0);
+#endif
 	}
 	else
 		success = false;
@@ -112,12 +233,10 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){
+	if (!waitq_empty (&sema->waiters)){
 		// for priority scheduling
-		// there may be cases of priority changes. do sort, to ensure that list is currently sorted : is it necessary?
-		list_sort (&sema->waiters, &cmp_priority_greater, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
+		// donations re-key waiters in place (waitq_reprioritize), so the root is always the highest
+		thread_unblock (waitq_pop (&sema->waiters));
 	}
 
 	sema->value++;
@@ -128,6 +247,7 @@ sema_up (struct semaphore *sema) {
 }
 
 static void sema_test_helper (void *sema_);
+static void cond_wake_one (struct condition *);
 
 /* Self-test for semaphores that makes control "ping-pong"
    between a pair of threads.  Insert calls to printf() to see
@@ -183,6 +303,7 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lock->hold.waiters = &lock->semaphore.waiters;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -204,24 +325,43 @@ lock_acquire (struct lock *lock) {
 	if (thread_mlfqs) {
 		sema_down (&lock->semaphore);
 		lock->holder = thread_current ();
+#ifdef LOCKSTAT
+		lock->hold_start = timer_cycles ();
+#endif
 		return;
 	}
 
 	// For priority donation
-	// If lock is held by other thread, 1. store lock in 'lock_waiting' 2. update donor_list of lock-holder 3. donate priority
-	if (lock->holder) {
-		thread_current ()->lock_waiting = lock;
-		// Private note : thread_current must be inserted to donor_list of 'direct donee' just once, not all nested donees.
-		list_insert_ordered (&lock->holder->donor_list, &thread_current ()->d_elem, &cmp_priority_greater_dona, NULL);
-		// Private note : if current thread is trying to acquire lock, it implies that priority of current thread is the HIGHEST among all threads
+	// Wait on the lock's semaphore directly, so that the donation happens with the waiter already queued:
+	// the highest waiter of a lock is then the root of its wait queue, and the holder only has to re-key that lock.
+	struct thread *curr = thread_current ();
+#ifdef LOCKSTAT
+	uint64_t wait_start = 0;
+#endif
+	enum intr_level old_level = intr_disable ();
+	while (lock->semaphore.value == 0) {
+#ifdef LOCKSTAT
+		if (wait_start == 0)
+			wait_start = timer_cycles ();
+#endif
+		waitq_push (&lock->semaphore.waiters, curr);
+		curr->lock_waiting = lock;
 		thread_donate_priority ();
+		thread_block ();
 	}
-
-	sema_down (&lock->semaphore);
+	lock->semaphore.value--;
+#ifdef LOCKSTAT
+	lockstat_acquired (&lock->semaphore, wait_start);
+	lock->hold_start = timer_cycles ();
+#endif
 	// For priority donation
-	// Update lock_waiting to NULL
-	thread_current ()->lock_waiting = NULL;
-	lock->holder = thread_current ();
+	// Update lock_waiting to NULL, and keep the lock in the new holder's heap of held locks
+	curr->lock_waiting = NULL;
+	lock->holder = curr;
+	heap_push (&curr->held_locks, &lock->hold.elem);
+	// Private note : other waiters may have been left behind on the lock, so they donate to the new holder
+	thread_update_priority ();
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -232,14 +372,25 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current ();
+#ifdef LOCKSTAT
+		lock->hold_start = timer_cycles ();
+#endif
+		if (!thread_mlfqs) {
+			heap_push (&lock->holder->held_locks, &lock->hold.elem);
+			thread_update_priority ();
+		}
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -255,6 +406,9 @@ lock_release (struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 	// For mlfqs
 	// If mlfqs is enabled, forbid logics for priority donation
+#ifdef LOCKSTAT
+	lockstat_released (lock);
+#endif
 	if (thread_mlfqs) {
 		lock->holder = NULL;
 		sema_up (&lock->semaphore);
@@ -262,14 +416,115 @@ lock_release (struct lock *lock) {
 	}
 
 	// For priority donation
-	// If lock is released, remove lock_waiting thread from donor_list and update priority of current thread
-	thread_remove_donor (lock);
+	// If lock is released, drop it from the held locks and update priority of current thread.
+	// Private note : interrupts stay off until the lock has a waiter queued for it again, so no donation
+	// can reach a lock that is out of every heap but still has a holder
+	enum intr_level old_level = intr_disable ();
+	heap_remove (&thread_current ()->held_locks, &lock->hold.elem);
 	thread_update_priority ();
 
 	lock->holder = NULL;
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
+}
+
+/* Returns the highest priority among the threads waiting for
+   what HOLD stands for, or PRI_MIN - 1 if there are none.
+   Interrupts must be off. */
+int
+lock_hold_priority (const struct lock_hold *hold) {
+	struct thread *t = waitq_top (hold->waiters);
+
+	return t != NULL ? t->priority : PRI_MIN - 1;
+}
+
+#ifdef LOCKSTAT
+/* Head of the registry of every `struct lockstat' attached so
+   far, most recent first. */
+static struct lockstat *lockstat_list;
+
+/* Makes SEMA keep its statistics in STAT, listing STAT in the
+   registry the first time it is used. */
+void
+lockstat_attach (struct semaphore *sema, struct lockstat *stat) {
+	enum intr_level old_level = intr_disable ();
+
+	if (!stat->registered) {
+		stat->registered = true;
+		stat->next = lockstat_list;
+		lockstat_list = stat;
+	}
+	sema->stat = stat;
+	intr_set_level (old_level);
+}
+
+/* Counts an acquisition of SEMA that started waiting at cycle
+   WAIT_START, or did not wait if WAIT_START is 0.  Interrupts
+   must be off. */
+static void
+lockstat_acquired (struct semaphore *sema, uint64_t wait_start) {
+	struct lockstat *stat = sema->stat;
+
+	if (stat == NULL)
+		return;
+	stat->acquired++;
+	if (wait_start != 0) {
+		uint64_t wait = timer_cycles () - wait_start;
+
+		stat->contended++;
+		stat->wait_total += wait;
+		if (wait > stat->wait_max)
+			stat->wait_max = wait;
+	}
 }
 
+/* Counts the time LOCK was held, as it is about to be released. */
+static void
+lockstat_released (struct lock *lock) {
+	struct lockstat *stat = lock->semaphore.stat;
+	enum intr_level old_level;
+	uint64_t hold;
+
+	if (stat == NULL)
+		return;
+	old_level = intr_disable ();
+	hold = timer_cycles () - lock->hold_start;
+	stat->hold_total += hold;
+	if (hold > stat->hold_max)
+		stat->hold_max = hold;
+	intr_set_level (old_level);
+}
+
+/* Converts CYCLES of the TSC to microseconds. */
+static uint64_t
+cycles_to_us (uint64_t cycles) {
+	uint64_t per_us = timer_cycles_per_sec () / 1000000;
+
+	return per_us != 0 ? cycles / per_us : 0;
+}
+
+/* Prints the statistics of every lock and semaphore that has
+   been acquired at least once, with times in microseconds. */
+void
+lockstat_print (void) {
+	struct lockstat *stat;
+
+	printf ("Lock statistics (times in us):\n");
+	printf ("%10s %10s %10s %8s %10s %8s  %s\n", "acquired", "contended",
+			"wait", "max", "hold", "max", "name");
+	for (stat = lockstat_list; stat != NULL; stat = stat->next) {
+		if (stat->acquired == 0)
+			continue;
+		printf ("%10"PRIu64" %10"PRIu64" %10"PRIu64" %8"PRIu64
+				" %10"PRIu64" %8"PRIu64"  %s (%s:%d)\n",
+				stat->acquired, stat->contended,
+				cycles_to_us (stat->wait_total), cycles_to_us (stat->wait_max),
+				cycles_to_us (stat->hold_total), cycles_to_us (stat->hold_max),
+				stat->name, stat->file, stat->line);
+	}
+}
+#endif
+
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -280,12 +535,6 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
-	struct semaphore semaphore;         /* This semaphore. */
-};
-
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -293,7 +542,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	waitq_init (&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -318,20 +567,25 @@ cond_init (struct condition *cond) {
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
-	struct semaphore_elem waiter;
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	sema_init (&waiter.semaphore, 0);
 	// for priority scheduling
-	// insertion strategy should be modified properly : to wake up thread with higher priority first
-	// list_insert_ordered (&cond->waiters, &waiter.elem, &cmp_priority_greater_sema, NULL);
-	list_push_back (&cond->waiters, &waiter.elem);
+	// queue the thread itself, so that donations to it re-key its place in COND
+	old_level = intr_disable ();
+	waitq_push (&cond->waiters, curr);
+	// Private note : releasing the lock may yield to a donor. A signal may then dequeue this thread while it is
+	// still READY, so block only while it is still queued.
 	lock_release (lock);
-	sema_down (&waiter.semaphore);
+	while (curr->waitq == &cond->waiters)
+		thread_block ();
+	intr_set_level (old_level);
+
 	lock_acquire (lock);
 }
 
@@ -349,14 +603,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters)){
-		// private note : due to the implementation of struct 'semaphore_elem' and function sema_down,
-		// sorting logic is applied when extracting element from list(not insertion) unlike other functions.
-		list_sort (&cond->waiters, &cmp_priority_greater_sema, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters), 
-					struct semaphore_elem, elem)->semaphore);	
+	enum intr_level old_level = intr_disable ();
+	if (!waitq_empty (&cond->waiters)){
+		cond_wake_one (cond);
+		thread_try_preemption ();
 	}
-	
+	intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -369,21 +621,450 @@ void
 cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (lock_held_by_current_thread (lock));
+
+	// Wake everyone first and check for preemption once, instead of once per waiter
+	enum intr_level old_level = intr_disable ();
+	while (!waitq_empty (&cond->waiters))
+		cond_wake_one (cond);
+	thread_try_preemption ();
+	intr_set_level (old_level);
+}
+
+/* Dequeues the highest-priority waiter on COND and makes it
+   ready, unless it has not blocked yet (see cond_wait()). */
+static void
+cond_wake_one (struct condition *cond) {
+	struct thread *t = waitq_pop (&cond->waiters);
+
+	if (t->status == THREAD_BLOCKED)
+		thread_unblock (t);
+}
+
+static bool rwlock_can_read (const struct rwlock *);
+static void rwlock_wait (struct rwlock *, bool writing);
+static void rwlock_wake (struct rwlock *);
+static void rwlock_grant_read (struct rwlock *, struct thread *);
+static void rwlock_grant_write (struct rwlock *, struct thread *);
+static void rwlock_drop_read (struct rwlock *, struct thread *);
+static struct rwlock_read *rwlock_read_hold (const struct rwlock *,
+		struct thread *);
+
+/* Initializes RW as unheld. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
 
-	while (!list_empty (&cond->waiters))
-		cond_signal (cond, lock);
+	rw->writer = NULL;
+	rw->reader_cnt = 0;
+	list_init (&rw->readers);
+	rw->writers_waiting = 0;
+	rw->upgrader = NULL;
+	waitq_init (&rw->waiters);
+	rw->write_hold.waiters = &rw->waiters;
 }
 
-// returns true if t1->priority is greater than t2->priority
-// similar in logic to cmp_priority_greater in thread.c, but adapted for use with struct 'semaphore_elem'.
-bool 
-cmp_priority_greater_sema (struct list_elem *e1, struct list_elem *e2) {
-	struct semaphore_elem *s_e1 = list_entry (e1, struct semaphore_elem, elem);
-	struct semaphore_elem *s_e2 = list_entry (e2, struct semaphore_elem, elem);
-	struct list *l1 = &s_e1->semaphore.waiters;
-	struct list *l2 = &s_e2->semaphore.waiters;
-	struct thread *t1 = list_entry (list_begin (l1), struct thread, elem);
-	struct thread *t2 = list_entry (list_begin (l2), struct thread, elem);
+/* Acquires RW for reading, sleeping while it is held for writing
+   or a writer is waiting for it.  RW must not already be held by
+   the current thread, which may hold at most RWLOCK_READ_MAX
+   rwlocks for reading at once.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_read_acquire (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rw));
+	ASSERT (rwlock_read_hold (rw, thread_current ()) == NULL);
+	ASSERT (rwlock_read_hold (NULL, thread_current ()) != NULL);
+
+	old_level = intr_disable ();
+	if (rwlock_can_read (rw))
+		rwlock_grant_read (rw, thread_current ());
+	else
+		rwlock_wait (rw, false);
+	intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for reading without sleeping.  Returns true
+   if successful, false if RW is held for writing or a writer is
+   waiting for it.  The same limits as rwlock_read_acquire()
+   apply. */
+bool
+rwlock_try_read_acquire (struct rwlock *rw) {
+	enum intr_level old_level;
+	bool success;
+
+	ASSERT (rw != NULL);
+	ASSERT (!rwlock_held_by_current_thread (rw));
+	ASSERT (rwlock_read_hold (rw, thread_current ()) == NULL);
+	ASSERT (rwlock_read_hold (NULL, thread_current ()) != NULL);
+
+	old_level = intr_disable ();
+	success = rwlock_can_read (rw);
+	if (success)
+		rwlock_grant_read (rw, thread_current ());
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void
+rwlock_read_release (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_read_hold (rw, thread_current ()) != NULL);
+
+	old_level = intr_disable ();
+	rwlock_drop_read (rw, thread_current ());
+	if (!thread_mlfqs)
+		thread_update_priority ();
+	rwlock_wake (rw);
+	thread_try_preemption ();
+	intr_set_level (old_level);
+}
 
-	return (t1->priority > t2->priority);
-}
\ No newline at end of file
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  RW must not already be held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_write_acquire (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rw));
+
+	old_level = intr_disable ();
+	if (rw->writer == NULL && rw->reader_cnt == 0 && rw->upgrader == NULL)
+		rwlock_grant_write (rw, thread_current ());
+	else {
+		rw->writers_waiting++;
+		rwlock_wait (rw, true);
+	}
+	intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for writing without sleeping.  Returns true
+   if successful, false if any other thread holds RW. */
+bool
+rwlock_try_write_acquire (struct rwlock *rw) {
+	enum intr_level old_level;
+	bool success;
+
+	ASSERT (rw != NULL);
+	ASSERT (!rwlock_held_by_current_thread (rw));
+
+	old_level = intr_disable ();
+	success = rw->writer == NULL && rw->reader_cnt == 0 && rw->upgrader == NULL;
+	if (success)
+		rwlock_grant_write (rw, thread_current ());
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_write_release (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_by_current_thread (rw));
+
+	old_level = intr_disable ();
+	heap_remove (&curr->held_locks, &rw->write_hold.elem);
+	rw->writer = NULL;
+	if (!thread_mlfqs)
+		thread_update_priority ();
+	rwlock_wake (rw);
+	thread_try_preemption ();
+	intr_set_level (old_level);
+}
+
+/* Turns the current thread's read hold on RW into a write hold,
+   sleeping until the other readers have released RW.  No writer
+   can get in between.
+
+   Only one reader can wait to upgrade at a time, since two would
+   wait for each other forever.  Returns false, with RW still held
+   for reading, if another reader is already waiting; the caller
+   must then release RW and acquire it for writing instead.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+rwlock_upgrade (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rwlock_read_hold (rw, curr) != NULL);
+
+	old_level = intr_disable ();
+	if (rw->upgrader != NULL) {
+		intr_set_level (old_level);
+		return false;
+	}
+
+	rwlock_drop_read (rw, curr);
+	if (!thread_mlfqs)
+		thread_update_priority ();
+	if (rw->reader_cnt == 0)
+		rwlock_grant_write (rw, curr);
+	else {
+		// for priority donation
+		// the upgrader waits like a writer, so it donates to the remaining readers
+		rw->upgrader = curr;
+		rwlock_wait (rw, true);
+	}
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Turns the current thread's read hold on RW into a write hold if
+   it is the only reader, without sleeping.  Returns true if
+   successful, false otherwise, in which case RW is still held for
+   reading. */
+bool
+rwlock_try_upgrade (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	bool success;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_read_hold (rw, curr) != NULL);
+
+	old_level = intr_disable ();
+	success = rw->reader_cnt == 1 && rw->upgrader == NULL;
+	if (success) {
+		rwlock_drop_read (rw, curr);
+		rwlock_grant_write (rw, curr);
+		if (!thread_mlfqs)
+			thread_update_priority ();
+	}
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Turns the current thread's write hold on RW into a read hold,
+   letting in the waiting readers too, unless a writer is
+   waiting.  The current thread must have a read hold to spare, as
+   for rwlock_read_acquire(). */
+void
+rwlock_downgrade (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_by_current_thread (rw));
+	ASSERT (rwlock_read_hold (NULL, curr) != NULL);
+
+	old_level = intr_disable ();
+	heap_remove (&curr->held_locks, &rw->write_hold.elem);
+	rw->writer = NULL;
+	rwlock_grant_read (rw, curr);
+	if (!thread_mlfqs)
+		thread_update_priority ();
+	rwlock_wake (rw);
+	thread_try_preemption ();
+	intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw->writer == thread_current ();
+}
+
+/* Passes the priorities of RW's waiters on to every thread that
+   holds RW, after the waiters have changed.  Interrupts must be
+   off. */
+void
+rwlock_donate (struct rwlock *rw) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rw->writer != NULL)
+		thread_donate_to (rw->writer, &rw->write_hold);
+	for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+			e = list_next (e)) {
+		struct rwlock_read *r = list_entry (e, struct rwlock_read, elem);
+		thread_donate_to (r->thread, &r->hold);
+	}
+}
+
+/* Returns true if a new reader may acquire RW right away.
+   Readers stay out while a writer holds RW or waits for it, or a
+   reader waits to upgrade. */
+static bool
+rwlock_can_read (const struct rwlock *rw) {
+	return rw->writer == NULL && rw->writers_waiting == 0
+		&& rw->upgrader == NULL;
+}
+
+/* Queues the current thread on RW for reading or WRITING and
+   sleeps.  The thread that wakes it hands RW over first, so RW is
+   held on return.  Interrupts must be off. */
+static void
+rwlock_wait (struct rwlock *rw, bool writing) {
+	struct thread *curr = thread_current ();
+
+	waitq_push (&rw->waiters, curr);
+	curr->rwlock_waiting = rw;
+	curr->rwlock_writing = writing;
+	rwlock_donate (rw);
+	thread_block ();
+}
+
+/* Hands RW over to as many waiters as can hold it now.  A waiting
+   upgrader goes first, once the last other reader is gone.
+   Otherwise waiters are served in priority order: a writer only
+   when nobody holds RW, and readers while no writer holds RW.
+   While a writer waits, readers are let in only one at a time,
+   when nobody holds RW, so that a stream of higher-priority
+   readers cannot keep the writer out forever.  Interrupts must be
+   off. */
+static void
+rwlock_wake (struct rwlock *rw) {
+	bool woken = false;
+
+	if (rw->upgrader != NULL) {
+		if (rw->reader_cnt == 0) {
+			struct thread *t = rw->upgrader;
+
+			rw->upgrader = NULL;
+			waitq_remove (t);
+			t->rwlock_waiting = NULL;
+			rwlock_grant_write (rw, t);
+			thread_unblock (t);
+			woken = true;
+		}
+	} else {
+		while (!waitq_empty (&rw->waiters)) {
+			struct thread *t = waitq_top (&rw->waiters);
+
+			if (t->rwlock_writing
+					? rw->writer != NULL || rw->reader_cnt > 0
+					: rw->writer != NULL
+						|| (rw->writers_waiting > 0 && rw->reader_cnt > 0))
+				break;
+
+			waitq_pop (&rw->waiters);
+			t->rwlock_waiting = NULL;
+			if (t->rwlock_writing) {
+				rw->writers_waiting--;
+				rwlock_grant_write (rw, t);
+			} else
+				rwlock_grant_read (rw, t);
+			thread_unblock (t);
+			woken = true;
+		}
+	}
+
+	// for priority donation
+	// the highest waiter may have changed, so the holders that were already there must be re-keyed
+	if (woken)
+		rwlock_donate (rw);
+}
+
+/* Makes T a reader of RW.  T must have a free read hold, which
+   its own call to rwlock_read_acquire() or rwlock_downgrade()
+   checked.  Interrupts must be off. */
+static void
+rwlock_grant_read (struct rwlock *rw, struct thread *t) {
+	struct rwlock_read *r = rwlock_read_hold (NULL, t);
+
+	ASSERT (r != NULL);
+
+	rw->reader_cnt++;
+	r->rwlock = rw;
+	r->thread = t;
+	r->hold.waiters = &rw->waiters;
+	list_push_back (&rw->readers, &r->elem);
+	heap_push (&t->held_locks, &r->hold.elem);
+	thread_donate_to (t, &r->hold);
+}
+
+/* Makes T the writer of RW.  Interrupts must be off. */
+static void
+rwlock_grant_write (struct rwlock *rw, struct thread *t) {
+	rw->writer = t;
+	heap_push (&t->held_locks, &rw->write_hold.elem);
+	thread_donate_to (t, &rw->write_hold);
+}
+
+/* Removes T from the readers of RW.  Interrupts must be off. */
+static void
+rwlock_drop_read (struct rwlock *rw, struct thread *t) {
+	struct rwlock_read *r = rwlock_read_hold (rw, t);
+
+	ASSERT (r != NULL);
+
+	rw->reader_cnt--;
+	r->rwlock = NULL;
+	list_remove (&r->elem);
+	heap_remove (&t->held_locks, &r->hold.elem);
+}
+
+/* Returns T's read hold on RW, or a free read hold of T if RW is
+   null.  Returns a null pointer if there is no such hold. */
+static struct rwlock_read *
+rwlock_read_hold (const struct rwlock *rw, struct thread *t) {
+	int i;
+
+	for (i = 0; i < RWLOCK_READ_MAX; i++)
+		if (t->rw_reads[i].rwlock == rw)
+			return &t->rw_reads[i];
+	return NULL;
+}
+
+/* Initializes spinlock S as released. */
+void
+spinlock_init (struct spinlock *s) {
+	ASSERT (s != NULL);
+
+	s->locked = 0;
+}
+
+/* Acquires spinlock S, spinning until it is available.
+   Disables interrupts on this CPU until spinlock_release(), so
+   the holder cannot be preempted or interrupted.  Spinlocks are
+   not recursive. */
+void
+spinlock_acquire (struct spinlock *s) {
+	enum intr_level old_level;
+
+	ASSERT (s != NULL);
+
+	old_level = intr_disable ();
+	while (__atomic_exchange_n (&s->locked, 1, __ATOMIC_ACQUIRE))
+		asm volatile ("pause");
+	s->old_level = old_level;
+}
+
+/* Releases spinlock S and restores the interrupt level that was
+   in effect when it was acquired. */
+void
+spinlock_release (struct spinlock *s) {
+	enum intr_level old_level;
+
+	ASSERT (s != NULL);
+	ASSERT (s->locked);
+
+	old_level = s->old_level;
+	__atomic_store_n (&s->locked, 0, __ATOMIC_RELEASE);
+	intr_set_level (old_level);
+}
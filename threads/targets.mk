@@ -3,7 +3,16 @@ threads_SRC += threads/thread.c		# Thread management core.
 threads_SRC += threads/interrupt.c	# Interrupt core.
 threads_SRC += threads/intr-stubs.S	# Interrupt stubs.
 threads_SRC += threads/synch.c		# Synchronization.
+threads_SRC += threads/futex.c		# Fast user-space locking.
+threads_SRC += threads/softirq.c	# Deferred interrupt work.
+threads_SRC += threads/workqueue.c	# Kernel worker threads.
+threads_SRC += threads/profile.c	# Sampling profiler.
 threads_SRC += threads/palloc.c		# Page allocator.
 threads_SRC += threads/malloc.c		# Subpage allocator.
+threads_SRC += threads/slab.c		# Object cache allocator.
 threads_SRC += threads/start.S		# Startup code.
+threads_SRC += threads/switch.S		# Thread switch routine.
+threads_SRC += threads/ap-start.S	# Application processor startup code.
+threads_SRC += threads/apic.c		# Local APIC.
+threads_SRC += threads/smp.c		# Multiprocessor support.
 threads_SRC += threads/mmu.c		    # Memory management unit related things.
@@ -7,9 +7,14 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
+#include "threads/softirq.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #include "lib/fixed.h"	// Privately added
 #ifdef USERPROG
@@ -25,16 +30,44 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-// List of sleeping threads 
-static struct list sleep_list;
-// List of ALL threads
-static struct list thread_list;
-
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   Each CPU has its own, holding the threads that will run on it.
+   There is one FIFO list per priority level, and bit P of
+   ready_mask is set whenever ready_queues[P] is nonempty, so the
+   highest ready priority can be found with a single bit scan.
+
+   A run queue is changed only with its lock held.  Every change
+   also happens with interrupts off, and so under the global
+   interrupt lock (see interrupt.c), which is enough to look at
+   any CPU's run queue. */
+struct runq {
+	struct spinlock lock;               /* Held while changing the queue. */
+	struct list ready_queues[PRI_MAX + 1];
+	uint64_t ready_mask;
+	int ready_cnt;                      /* # of threads in the queue. */
+	int dl_cnt;                         /* # of those in edf_queue. */
+
+	// Variables for cfs
+	// Private note : every runnable thread of the CPU is in 'cfs_queue' except the running one, like the priority run queues
+	struct rb_tree cfs_queue;			// Ready threads, least vruntime first
+	long cfs_load;						// Sum of the weights of the threads in cfs_queue
+	int64_t cfs_min_vruntime;			// Lower bound of runnable vruntimes, never decreases
+
+	// Variables for deadline scheduling
+	// Private note : ready deadline threads are kept apart from every other class, and always run first
+	struct rb_tree edf_queue;			// Ready deadline threads, earliest deadline first
+	int64_t dl_util;					// Sum of runtime / deadline of deadline threads admitted to the CPU, scaled by DL_UTIL_SCALE
+};
+static struct runq runqs[CPU_MAX];
+
+/* Run queue of CPU C, and of the CPU that thread T runs or is
+   queued on. */
+#define cpu_rq(c) (&runqs[(c)->id])
+#define thread_rq(t) cpu_rq ((t)->cpu)
+
+/* Returns true if T is the idle thread of its CPU. */
+#define is_idle_thread(t) ((t) == (t)->cpu->idle_thread)
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -42,8 +75,14 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
-/* Thread destruction requests */
-static struct list destruction_req;
+/* Pages of dead threads, most recently dead first, kept for
+   thread_create() to reuse instead of going to the page allocator.
+   A dying thread adds its own page in schedule(), while it still
+   runs on it; since interrupts stay off until it switches away,
+   no other thread sees the page before it is free. */
+static struct list thread_page_cache;
+static size_t thread_page_cache_cnt;
+#define THREAD_PAGE_CACHE_MAX 16  /* Most pages kept in the cache. */
 
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
@@ -52,19 +91,69 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+#define BALANCE_INTERVAL 4      /* # of timer ticks between load balancing. */
 
 // Variables for mlfqs
 static int fixed_load_avg; 			// Load_avg, scaled to fixed point
 static const int fixed_w1 = 16110;	// fixed point of 59/60, Weight value used in thread_recalc_load_avg
 static const int fixed_w2 = 273;	// fixed point of 1/60, Weight value used in thread_recalc_load_avg
+static int64_t mlfqs_seconds;		// # of once-per-second recent_cpu decays done so far
+#define DECAY_HIST_SIZE 64			// # of recent decay coefficients kept for lazily decayed threads
+static int fixed_decay_hist[DECAY_HIST_SIZE];	// Decay coefficient of second S, at index S % DECAY_HIST_SIZE
+static struct list decay_buckets[DECAY_HIST_SIZE];	// Blocked threads, at index recent_cpu_seconds % DECAY_HIST_SIZE
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+// Constants for cfs
+#define CFS_LATENCY_NS 40000000		// Period in which every runnable thread should run once, 4 ticks
+#define CFS_MIN_GRANULARITY_NS 10000000	// Least time a thread runs before it is preempted, 1 tick
+#define CFS_WAKEUP_GRANULARITY_NS 5000000	// Least vruntime lead for a woken thread to preempt
+#define CFS_NICE_0_WEIGHT 1024		// Weight of nice 0
+// Weight of each nice value from -20 to 20, each step about 1.25 times the next, as in Linux
+static const int cfs_nice_weight[41] = {
+	88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+	9548, 7620, 6100, 4904, 3906, 3121, 2501, 1991, 1586, 1277,
+	1024, 820, 655, 526, 423, 335, 272, 215, 172, 137,
+	110, 87, 70, 56, 45, 36, 29, 23, 18, 15,
+	12,
+};
+
+// Constants for deadline scheduling
+#define DL_UTIL_SCALE (1 << 20)
+#define DL_UTIL_MAX (DL_UTIL_SCALE / 100 * 95)	// Admission bound of each CPU, leaving it 5% for the other threads
+
+/* CPU bandwidth group.  The threads in a group may use QUOTA ticks
+   of CPU in every PERIOD ticks between them.  A thread that runs
+   the group out of runtime is throttled, that is, kept off the run
+   queue until the group is refilled at the start of the next
+   period.
+
+   Threads join the group of the thread that creates them, so a
+   group covers a process and everything it starts.  A group is
+   nested inside the group its owner was in when it was created,
+   and a thread is charged in every group up the chain, so that
+   the owner cannot escape the limits of its own group. */
+struct cpu_group {
+	struct cpu_group *parent;           /* Enclosing group, or null. */
+	tid_t owner;                        /* Thread that created the group. */
+	int64_t quota;                      /* Ticks per period, or -1 for no limit. */
+	int64_t period;                     /* Period in ticks. */
+	int64_t runtime;                    /* Ticks left in this period. */
+	struct list throttled;              /* Throttled threads. */
+	struct timer refill;                /* Refills RUNTIME every period. */
+	int ref_cnt;                        /* Threads and groups in the group. */
+};
+
 static void kernel_thread (thread_func *, void *aux);
+static struct thread *thread_page_get (void);
+static void thread_page_trim (void);
 
 static void idle (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
@@ -72,7 +161,37 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
-
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static int ready_queue_max_priority (struct runq *);
+static struct cpu *thread_select_cpu (struct thread *);
+static void thread_migrate (struct thread *, struct cpu *);
+static int cpu_load (struct cpu *);
+static struct cpu *cpu_busiest (struct cpu *self);
+static void thread_pull (struct cpu *src, struct cpu *dst);
+static bool thread_steal (void);
+static bool thread_balance (void);
+static struct cpu *dl_admit (int64_t density);
+static void thread_set_effective_priority (struct thread *, int priority);
+static int thread_effective_priority (struct thread *);
+static bool cmp_priority_greater_lock (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+static void thread_sleep_expired (void *t_);
+static int thread_mlfqs_priority (struct thread *);
+static int cfs_weight (const struct thread *);
+static bool cfs_less (const struct rb_elem *, const struct rb_elem *, void *aux);
+static void cfs_update_curr (struct thread *);
+static int64_t cfs_slice (const struct thread *);
+static bool cfs_tick_preempt (struct thread *);
+static struct thread *thread_alloc (const char *name, int priority,
+		thread_func *, void *aux);
+static void thread_preempt (void);
+static int64_t dl_density (int64_t runtime, int64_t deadline);
+static bool edf_less (const struct rb_elem *, const struct rb_elem *, void *aux);
+static void thread_dl_release (void *t_);
+static void cpu_group_refill (void *g_);
+static void cpu_group_wake (struct cpu_group *);
+static void cpu_group_put (struct cpu_group *);
 
 
 /* Returns true if T appears to point to a valid thread. */
@@ -119,19 +238,49 @@ thread_init (void) {
 
 	/* Init the global thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&destruction_req);
-	// additional inits
-	list_init (&sleep_list);
-	list_init (&thread_list);
+	for (int c = 0; c < CPU_MAX; c++) {
+		struct runq *rq = &runqs[c];
+
+		spinlock_init (&rq->lock);
+		for (int i = PRI_MIN; i <= PRI_MAX; i++)
+			list_init (&rq->ready_queues[i]);
+		rq->ready_mask = 0;
+		rq->ready_cnt = 0;
+		rq->dl_cnt = 0;
+		rb_init (&rq->cfs_queue, cfs_less, NULL);
+		rq->cfs_load = 0;
+		rq->cfs_min_vruntime = 0;
+		rb_init (&rq->edf_queue, edf_less, NULL);
+		rq->dl_util = 0;
+	}
+	list_init (&thread_page_cache);
+	thread_page_cache_cnt = 0;
+	for (int i = 0; i < DECAY_HIST_SIZE; i++)
+		list_init (&decay_buckets[i]);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
+	initial_thread->cpu = &cpus[0];
+	cpus[0].curr = initial_thread;
 	initial_thread->tid = allocate_tid ();
 }
 
+/* Turns the code running on an application processor, which is
+   on the stack of the thread made for it by thread_create_idle(),
+   into that thread. */
+void
+thread_init_ap (void) {
+	struct thread *t = running_thread ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (is_thread (t) && is_idle_thread (t));
+
+	t->status = THREAD_RUNNING;
+	t->cpu->curr = t;
+}
+
 /* Starts preemptive thread scheduling by enabling interrupts.
    Also creates the idle thread. */
 void
@@ -148,15 +297,57 @@ thread_start (void) {
 	sema_down (&idle_started);
 }
 
+/* Creates the idle thread of application processor C, which
+   starts out on its stack, and returns it.  The thread is not
+   added to any run queue: C runs it from thread_start_ap(). */
+struct thread *
+thread_create_idle (struct cpu *c) {
+	struct thread *t;
+	char name[16];
+
+	t = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	snprintf (name, sizeof name, "idle%d", c->id);
+	init_thread (t, name, PRI_MIN);
+	t->tid = allocate_tid ();
+	t->cpu = c;
+	c->idle_thread = t;
+	return t;
+}
+
+/* Starts scheduling threads on the running application
+   processor, by becoming its idle thread.  Never returns. */
+void
+thread_start_ap (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	cpu_current ()->online = true;
+	idle (NULL);
+	NOT_REACHED ();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
 thread_tick (void) {
+	struct cpu *c = cpu_current ();
 	struct thread *t = thread_current ();
 
-	/* Update statistics. */
-	if (t == idle_thread)
+	// For multiprocessors
+	// Every BALANCE_INTERVAL ticks, pull ready threads over from the busiest CPU
+	if (++c->balance_ticks >= BALANCE_INTERVAL) {
+		c->balance_ticks = 0;
+		if (thread_balance ())
+			thread_try_preemption ();
+	}
+
+	/* Update statistics.  The idle thread needs no time slice: it
+	   blocks again as soon as the interrupt that woke it returns.
+	   This may also be called by the idle thread itself, when it
+	   catches up on ticks skipped in tickless mode. */
+	if (is_idle_thread (t)) {
 		idle_ticks++;
+		return;
+	}
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
 		user_ticks++;
@@ -164,8 +355,44 @@ thread_tick (void) {
 	else
 		kernel_ticks++;
 
+	// For cpu bandwidth control
+	// Charge the tick to every group the thread is in, and throttle it once one of them runs out of runtime
+	if (t->cpu_group != NULL) {
+		struct cpu_group *g;
+
+		t->cpu_throttled = NULL;
+		for (g = t->cpu_group; g != NULL; g = g->parent)
+			if (g->quota >= 0 && --g->runtime <= 0 && t->cpu_throttled == NULL)
+				t->cpu_throttled = g;
+		if (t->cpu_throttled != NULL)
+			intr_yield_on_return ();
+	}
+
+	// For deadline scheduling
+	// Charge the tick to the budget of the current job, and throttle the thread once it runs past the budget
+	// A job that ends on the tick that uses up its budget ran exactly its runtime, which is not an overrun
+	// Private note : the miss, if any, is counted in thread_dl_release(), once the job's deadline has passed
+	if (t->dl_period != 0) {
+		t->dl_budget--;
+		if (t->dl_budget < 0 && !t->dl_throttled) {
+			t->dl_throttled = true;
+			timer_arm (&t->dl_timer, t->dl_release + t->dl_period);
+			intr_yield_on_return ();
+		}
+		return;
+	}
+
+	// For cfs
+	// Preempt once the thread has run its share of the latency period, instead of a fixed time slice
+	if (thread_cfs) {
+		cfs_update_curr (t);
+		if (cfs_tick_preempt (t))
+			intr_yield_on_return ();
+		return;
+	}
+
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (++c->thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 }
 
@@ -197,16 +424,269 @@ thread_create (const char *name, int priority,
 	struct thread *t;
 	tid_t tid;
 
+	t = thread_alloc (name, priority, function, aux);
+	if (t == NULL)
+		return TID_ERROR;
+	tid = t->tid;
+
+	/* Add to run queue. */
+	thread_unblock (t);		// note : default value of newly initiated thread's status is BLOCKED
+
+	// for priority scheduling
+	// try preemption
+	thread_try_preemption ();
+
+	return tid;
+}
+
+/* Creates a new kernel thread like thread_create(), in the
+   deadline scheduling class.  The thread runs periodic jobs: the
+   first one is released right away, and each call to
+   thread_wait_next_period() ends one and waits for the release of
+   the next, PERIOD ticks after the previous.  Each job should be
+   done within DEADLINE ticks of its release, using at most
+   RUNTIME ticks of CPU.  A thread that runs past its RUNTIME
+   budget is throttled until the next release.
+
+   Ready deadline threads run ahead of all other threads of their
+   CPU, earliest deadline first, and never move to another CPU.
+   To keep every deadline met, the thread is only admitted to a
+   CPU if the sum of RUNTIME / DEADLINE over the deadline threads
+   of that CPU stays within DL_UTIL_MAX.  Returns TID_ERROR if no
+   CPU admits the thread or it cannot be created. */
+tid_t
+thread_create_deadline (const char *name, int64_t runtime, int64_t period,
+		int64_t deadline, thread_func *function, void *aux) {
+	int64_t density;
+	enum intr_level old_level;
+	struct cpu *c;
+	struct thread *t;
+	tid_t tid;
+
+	if (runtime <= 0 || runtime > deadline || deadline > period)
+		return TID_ERROR;
+
+	/* Admission control. */
+	density = dl_density (runtime, deadline);
+	old_level = intr_disable ();
+	c = dl_admit (density);
+	if (c == NULL) {
+		intr_set_level (old_level);
+		return TID_ERROR;
+	}
+	cpu_rq (c)->dl_util += density;
+	intr_set_level (old_level);
+
+	t = thread_alloc (name, PRI_MAX, function, aux);
+	if (t == NULL) {
+		old_level = intr_disable ();
+		cpu_rq (c)->dl_util -= density;
+		intr_set_level (old_level);
+		return TID_ERROR;
+	}
+	tid = t->tid;
+	t->cpu = c;
+
+	t->dl_runtime = runtime;
+	t->dl_period = period;
+	t->dl_rel_deadline = deadline;
+	t->dl_release = timer_ticks ();
+	t->dl_deadline = t->dl_release + deadline;
+	t->dl_budget = runtime;
+	timer_setup (&t->dl_timer, thread_dl_release, t);
+
+	thread_unblock (t);
+	thread_try_preemption ();
+
+	return tid;
+}
+
+/* Ends the running deadline thread's current job, and waits for
+   the release of the next one.  A job that ends after its deadline
+   is counted as a miss. */
+void
+thread_wait_next_period (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	int64_t now;
+
+	ASSERT (!intr_context ());
+	ASSERT (curr->dl_period != 0);
+
+	old_level = intr_disable ();
+	now = timer_ticks ();
+	if (now > curr->dl_deadline)
+		curr->dl_misses++;
+	if (curr->dl_release + curr->dl_period > now) {
+		timer_arm (&curr->dl_timer, curr->dl_release + curr->dl_period);
+		thread_block ();
+	} else
+		thread_dl_release (curr);
+	intr_set_level (old_level);
+}
+
+/* Returns the number of deadline misses of the running deadline
+   thread so far, counting both jobs that ended late and jobs that
+   were still throttled for overrunning their budget when their
+   deadline passed. */
+unsigned
+thread_deadline_misses (void) {
+	return thread_current ()->dl_misses;
+}
+
+/* Releases the next job of deadline thread T_: refills its budget,
+   sets the new deadline, and makes T_ ready if it was waiting or
+   throttled.  Called from the timer softirq at the release time,
+   or by thread_wait_next_period() when the release is already
+   due. */
+static void
+thread_dl_release (void *t_) {
+	struct thread *t = t_;
+	int64_t now = timer_ticks ();
+
+	// A job still throttled at the next release could not finish by its deadline, which is never after the release
+	if (t->dl_throttled && now >= t->dl_deadline)
+		t->dl_misses++;
+
+	// Skip the releases the thread was too late for, rather than run jobs that have already missed
+	t->dl_release += t->dl_period;
+	if (t->dl_release + t->dl_rel_deadline <= now)
+		t->dl_release = now;
+	t->dl_deadline = t->dl_release + t->dl_rel_deadline;
+	t->dl_budget = t->dl_runtime;
+	t->dl_throttled = false;
+
+	if (t->status == THREAD_BLOCKED) {
+		thread_unblock (t);
+		thread_try_preemption ();
+	}
+}
+
+/* Limits the CPU time of the running thread, together with the
+   threads it creates from now on, to QUOTA ticks in every PERIOD
+   ticks.  A negative QUOTA removes the limit.
+
+   The first call creates a new CPU group for the running thread,
+   inside the group it was in.  Later calls by the same thread
+   change the limits of that group.  Returns 0 if successful, -1
+   if QUOTA and PERIOD are invalid or no memory is available. */
+int
+thread_set_cpu_quota (int64_t quota, int64_t period) {
+	struct thread *curr = thread_current ();
+	struct cpu_group *g = curr->cpu_group;
+	enum intr_level old_level;
+
+	if (quota >= 0 && (period <= 0 || quota == 0 || quota > period))
+		return -1;
+
+	if (g == NULL || g->owner != curr->tid) {
+		struct cpu_group *new = malloc (sizeof *new);
+		if (new == NULL)
+			return -1;
+
+		/* The new group takes over our reference to G. */
+		new->parent = g;
+		new->owner = curr->tid;
+		new->quota = -1;
+		new->period = 0;
+		new->runtime = 0;
+		list_init (&new->throttled);
+		timer_setup (&new->refill, cpu_group_refill, new);
+		new->ref_cnt = 1;
+		g = new;
+	}
+
+	old_level = intr_disable ();
+	curr->cpu_group = g;
+	g->quota = quota;
+	g->period = period;
+	g->runtime = quota;
+	if (quota >= 0)
+		timer_arm (&g->refill, timer_ticks () + period);
+	else
+		timer_cancel (&g->refill);
+	cpu_group_wake (g);
+	intr_set_level (old_level);
+
+	return 0;
+}
+
+/* Starts a new period of group G_: refills its runtime and makes
+   its throttled threads ready again.  Called from the timer
+   softirq. */
+static void
+cpu_group_refill (void *g_) {
+	struct cpu_group *g = g_;
+
+	g->runtime = g->quota;
+	timer_arm (&g->refill, g->refill.expires + g->period);
+	cpu_group_wake (g);
+}
+
+/* Makes the throttled threads of G ready.  Must be called with
+   interrupts off. */
+static void
+cpu_group_wake (struct cpu_group *g) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (list_empty (&g->throttled))
+		return;
+	while (!list_empty (&g->throttled)) {
+		struct thread *t = list_entry (list_pop_front (&g->throttled), struct thread, elem);
+		t->cpu_throttled = NULL;
+		thread_unblock (t);
+	}
+	thread_try_preemption ();
+}
+
+/* Drops a reference to G, and frees G and then its enclosing
+   groups as they lose their last reference. */
+static void
+cpu_group_put (struct cpu_group *g) {
+	while (g != NULL) {
+		struct cpu_group *parent = g->parent;
+		enum intr_level old_level;
+		bool last;
+
+		old_level = intr_disable ();
+		last = --g->ref_cnt == 0;
+		if (last)
+			timer_cancel (&g->refill);
+		intr_set_level (old_level);
+
+		if (!last)
+			break;
+		free (g);
+		g = parent;
+	}
+}
+
+/* Returns RUNTIME / DEADLINE, scaled by DL_UTIL_SCALE and rounded
+   up. */
+static int64_t
+dl_density (int64_t runtime, int64_t deadline) {
+	return (runtime * DL_UTIL_SCALE + deadline - 1) / deadline;
+}
+
+/* Allocates and initializes a thread named NAME with PRIORITY that
+   will run FUNCTION (AUX), and gives it a tid.  The thread is left
+   blocked.  Returns a null pointer if no page is available. */
+static struct thread *
+thread_alloc (const char *name, int priority,
+		thread_func *function, void *aux) {
+	enum intr_level old_level;
+	struct thread *t;
+
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_get ();
 	if (t == NULL)
-		return TID_ERROR;
+		return NULL;
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
-	tid = t->tid = allocate_tid ();
+	t->tid = allocate_tid ();
 
 	/* Call the kernel_thread if it scheduled.
 	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
@@ -219,14 +699,14 @@ thread_create (const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-	/* Add to run queue. */
-	thread_unblock (t);		// note : default value of newly initiated thread's status is BLOCKED
-
-	// for priority scheduling
-	// try preemption
-	thread_try_preemption ();
+	/* Join the CPU group of the creating thread. */
+	old_level = intr_disable ();
+	t->cpu_group = thread_current ()->cpu_group;
+	if (t->cpu_group != NULL)
+		t->cpu_group->ref_cnt++;
+	intr_set_level (old_level);
 
-	return tid;
+	return t;
 }
 
 /* Puts the current thread to sleep.  It will not be scheduled
@@ -239,50 +719,44 @@ void
 thread_block (void) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
-	thread_current ()->status = THREAD_BLOCKED;
+	struct thread *curr = thread_current ();
+
+	// For mlfqs
+	// Leave the decays of the time spent blocked to thread_unblock, but let the once-per-second
+	// update catch curr up before its oldest missed coefficient drops out of fixed_decay_hist
+	if (thread_mlfqs && !is_idle_thread (curr)) {
+		list_push_back (&decay_buckets[curr->recent_cpu_seconds % DECAY_HIST_SIZE], &curr->decay_elem);
+		curr->decay_blocked = true;
+	}
+
+	curr->status = THREAD_BLOCKED;
 	schedule ();
 }
 
-// for current thread : update ticks_to_wakeup, push back in the sleep_list, and change status to BLOCKED. 
+// for current thread : arm its sleep timer for tick 'ticks', and change status to BLOCKED.
+// Must be called with interrupts off.
 void
 thread_sleep (int64_t ticks) {
 	struct thread *curr = thread_current ();
 	// check if current thread is NOT idle
-	if (curr != idle_thread){
-		// update 'ticks_to_wakeup' of current thread to 'ticks'
-		curr->ticks_to_wakeup = ticks;
-
-		// put current thread in sleep_list
-		list_push_back (&sleep_list, &(curr->elem)); // note : seems list_push_back could be replaced with 'list_insert_ordered', need check!
+	if (!is_idle_thread (curr)){
+		// the timer wheel calls thread_sleep_expired () once 'ticks' is reached
+		timer_arm (&curr->sleep_timer, ticks);
 		
 		// change status of current thread to BLOCKED and call schedule for context switching
 		thread_block ();
 	}
 }
 
+// Sleep timer callback, run from the timer interrupt : move the expired sleeper to the run queue
+static void
+thread_sleep_expired (void *t_) {
+	struct thread *t = t_;
 
-// if wakeup ticks of thread in sleep_list is expired, move the thread to ready_list and set status to READY
-void
-thread_wakeup (int64_t ticks) {
-	struct list_elem *e = list_begin(&sleep_list);
-
-	// note : should be modified, if thread_sleep use 'list_insert_ordered'
-	while (e != list_end(&sleep_list)) {
-		struct thread *t = list_entry(e, struct thread, elem);
-		struct list_elem *next = list_next(e);
-		// move expired thread, from sleep queue to ready queue
-		if (t->ticks_to_wakeup <= ticks) { // if time has passed enough
-			list_remove(e);
-			thread_unblock(t);
-		}
-
-		e = next;
-	}
+	thread_unblock (t);
+	thread_try_preemption ();
 }
 
-
-
-
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -294,18 +768,45 @@ thread_wakeup (int64_t ticks) {
 void
 thread_unblock (struct thread *t) {
 	enum intr_level old_level;
+	struct cpu *c;
+	struct runq *rq;
 
 	ASSERT (is_thread (t));
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
 
+	// For mlfqs
+	// Apply the recent_cpu decays t missed while blocked, before it is queued by priority
+	if (thread_mlfqs) {
+		if (t->decay_blocked) {
+			list_remove (&t->decay_elem);
+			t->decay_blocked = false;
+		}
+		thread_recalc_recent_cpu (t);
+		thread_recalc_priority (t);
+	}
+
+	// For multiprocessors
+	// Choose the CPU that will run t, and move t over to it
+	c = thread_select_cpu (t);
+	thread_migrate (t, c);
+	rq = cpu_rq (c);
+
+	// For cfs
+	// Place t fairly : a sleeper gets at most half a latency period of credit over the threads
+	// that kept running, and new threads start at the current minimum
+	if (thread_cfs && t->vruntime < rq->cfs_min_vruntime - CFS_LATENCY_NS / 2)
+		t->vruntime = rq->cfs_min_vruntime - CFS_LATENCY_NS / 2;
+
 	// for priority scheduling
-	// insertion strategy should be modified properly : maintain the ready queue in descending order of priority
-	list_insert_ordered (&ready_list, &(t->elem), &cmp_priority_greater, NULL);
-	// list_push_back (&ready_list, &t->elem);
-	
+	// Queue t at the tail of the run queue of its own priority
+	ready_queue_push (t);
 	t->status = THREAD_READY;
+
+	// For multiprocessors
+	// Another CPU checks for itself whether t preempts its running thread, like the caller does with thread_try_preemption()
+	smp_send_resched (c);
 	intr_set_level (old_level);
 }
 
@@ -343,17 +844,33 @@ thread_tid (void) {
    returns to the caller. */
 void
 thread_exit (void) {
+	struct cpu_group *cpu_group;
+	enum intr_level old_level;
+
 	ASSERT (!intr_context ());
 
 #ifdef USERPROG
 	process_exit ();
 #endif
 
+	/* Leave our CPU group, if any. */
+	old_level = intr_disable ();
+	cpu_group = thread_current ()->cpu_group;
+	thread_current ()->cpu_group = NULL;
+	intr_set_level (old_level);
+	cpu_group_put (cpu_group);
+
 	/* Just set our status to dying and schedule another process.
-	   We will be destroyed during the call to schedule_tail(). */
+	   Our page goes to the page cache in schedule().  Make room for
+	   it here, freeing pages now rather than in the scheduler, and
+	   with interrupts already off, so that no other thread can
+	   exit and fill the cache before our page is added. */
 	intr_disable ();
-	// Remove dying thread from thread_list
-	list_remove (&thread_current ()->t_elem);
+	thread_page_trim ();
+	// For deadline scheduling
+	// Give the thread's share back to admission control
+	if (thread_current ()->dl_period != 0)
+		thread_rq (thread_current ())->dl_util -= dl_density (thread_current ()->dl_runtime, thread_current ()->dl_rel_deadline);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -368,25 +885,74 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		// for priority scheduling
-		// insertion strategy should be modified properly : maintain the ready queue in descending order of priority
-		list_insert_ordered (&ready_list, &(curr->elem), &cmp_priority_greater, NULL);
-		// list_push_back (&ready_list, &curr->elem);
-	do_schedule (THREAD_READY);
+	// For deadline scheduling
+	// A throttled thread is not runnable until its dl_timer releases the next job
+	if (curr->dl_throttled)
+		thread_block ();
+	// For cpu bandwidth control
+	// A throttled thread waits for its group to be refilled, unless that already happened
+	else if (curr->cpu_throttled != NULL && curr->cpu_throttled->runtime <= 0) {
+		list_push_back (&curr->cpu_throttled->throttled, &curr->elem);
+		thread_block ();
+	} else {
+		curr->cpu_throttled = NULL;
+		if (!is_idle_thread (curr))
+			// for priority scheduling
+			// Yielding thread goes behind threads of the same priority
+			ready_queue_push (curr);
+		do_schedule (THREAD_READY);
+	}
 	intr_set_level (old_level);
 }
 
-// Compare priority of current thread with the very first thread in the ready queue
-// If the first thread has a higher priority than current one, call yield () for preemption
+// Compare priority of current thread with the highest priority in the run queue of its CPU
+// If a ready thread has a higher priority than current one, yield for preemption
+// Inside an interrupt handler, the yield is deferred until the handler returns
+// The idle thread is never preempted : it picks up the ready thread itself right after waking up
 void
 thread_try_preemption (void) {
-	if (list_empty (&ready_list))
+	struct runq *rq = thread_rq (thread_current ());
+
+	if (rq->ready_cnt == 0 || is_idle_thread (thread_current ()))
+		return;
+
+	// For deadline scheduling
+	// A ready deadline thread preempts any thread of another class, or a deadline thread with a later deadline
+	if (!rb_empty (&rq->edf_queue) || thread_current ()->dl_period != 0) {
+		struct thread *curr = thread_current ();
+
+		if (!rb_empty (&rq->edf_queue)) {
+			struct thread *first = rb_entry (rb_first (&rq->edf_queue), struct thread, dl_elem);
+			if (curr->dl_period == 0 || first->dl_deadline < curr->dl_deadline)
+				thread_preempt ();
+		}
 		return;
+	}
+
+	// For cfs
+	// Preempt if the leftmost ready thread is behind the current one by more than the wakeup granularity
+	if (thread_cfs) {
+		struct thread *curr = thread_current ();
+		struct thread *first = rb_entry (rb_first (&rq->cfs_queue), struct thread, cfs_elem);
+		int64_t gran = (int64_t) CFS_WAKEUP_GRANULARITY_NS * CFS_NICE_0_WEIGHT / cfs_weight (first);
+
+		cfs_update_curr (curr);
+		if (curr->vruntime - first->vruntime > gran)
+			thread_preempt ();
+		return;
+	}
 
-	// Ensure that ready_list is sorted by priority before popping thread from ready_list
-	list_sort (&ready_list, &cmp_priority_greater, NULL);
-	if (thread_current ()->priority < list_entry (list_front(&ready_list), struct thread, elem)->priority)
+	if (thread_current ()->priority < ready_queue_max_priority (rq))
+		thread_preempt ();
+}
+
+// Gives up the CPU to a ready thread that should run instead of the current one
+// Inside an interrupt handler, the yield is deferred until the handler returns
+static void
+thread_preempt (void) {
+	if (intr_context ())
+		intr_yield_on_return ();
+	else
 		thread_yield ();
 }
 
@@ -413,74 +979,56 @@ thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
-// Donates priority of current thread to holder of lock being requested and update holder's donor_list, if donor has higher priority
+// Donates priority of current thread to holder of the lock it is waiting for.
+// The current thread must already be queued on the lock, so that the lock's key in the holder's heap reflects it.
 void
 thread_donate_priority (void) {
-	// Initial check for donor and donee
-	struct thread *donor = thread_current ();
-	if (!donor->lock_waiting) 
+	struct lock *lock = thread_current ()->lock_waiting;
+	if (!lock || !lock->holder)
 		return;
-	struct thread *donee = donor->lock_waiting->holder;
 
-	// Private note : If priority of donor is higher than that of donee, it implies that priority of all nested holders should be updated.
-	// Else we could skip priority donation, because nested holders already have higher priority than current thread
-	if (donor->priority <= donee->priority)
-		return;	
+	thread_donate_to (lock->holder, &lock->hold);
+}
+
+// Re-keys HOLD in the heap of HOLDER, which holds it, after its waiters changed, and updates HOLDER's priority.
+// Private note : nested donation is carried on by thread_set_effective_priority, as deep as the chain goes
+void
+thread_donate_to (struct thread *holder, struct lock_hold *hold) {
+	if (thread_mlfqs)
+		return;
 
-	// Implement nested donation
 	enum intr_level old_level = intr_disable ();
-	int max_nested_depth = 8;
-	for (int i = 0; i < max_nested_depth; i++) {
-		donee->priority = donor->priority;
-		
-		donor = donee;
-		if (!donor->lock_waiting) 
-			break;
-		donee = donor->lock_waiting->holder;
-	}
+	heap_update (&holder->held_locks, &hold->elem);
+	thread_set_effective_priority (holder, thread_effective_priority (holder));
 	intr_set_level (old_level);
 }
 
-// Update priority of current thread by checking donor_list
-// Check current thread's original priority and its donors' priorities, and set HIGHEST priority among them.
+// Update priority of current thread from its original priority and the locks it holds
 void 
 thread_update_priority (void) {
 	struct thread *curr = thread_current ();
-	// Private note : Considering the possibility that the priority of current thread is changed due to nested donation, 
-	// this function will unconditionally set its priority to original level.
-	curr->priority = curr->original_priority;
-
-	// If empty, there is no need to further updates
-	if (list_empty (&curr->donor_list))
-		return;
-
-	// Private note : call sort function, ensuring that donor_list is sorted by priority
-	list_sort (&curr->donor_list, &cmp_priority_greater_dona, NULL);
-	struct thread *highest_donor = list_entry (list_front (&curr->donor_list), struct thread, d_elem);
-	if (highest_donor->priority > curr->priority)
-		curr->priority = highest_donor->priority;
+	// Private note : go through thread_set_effective_priority, since current thread may already be queued on a condition
+	thread_set_effective_priority (curr, thread_effective_priority (curr));
 }
 
-// Traverse donor_list of current thread and remove donor if that donor is wating for 'lock'
-void 
-thread_remove_donor (struct lock *lock) {
-	struct thread *curr = thread_current ();
-	if (list_empty (&curr->donor_list))
-		return;
-	
-	struct list_elem *d_e = list_front (&curr->donor_list);
-	while (d_e != list_end (&curr->donor_list)) {
-		struct thread *t = list_entry (d_e, struct thread, d_elem);
-		struct list_elem *d_e_next = list_next(d_e);
-		if (t->lock_waiting == lock)
-			list_remove (&t->d_elem);
-		d_e = d_e_next;
+// Returns HIGHEST priority among T's original priority and the waiters of the locks T holds.
+// The held lock with the highest waiter is always on top of 'held_locks', so this is O(1).
+static int
+thread_effective_priority (struct thread *t) {
+	int priority = t->original_priority;
+	struct heap_elem *top = heap_top (&t->held_locks);
+
+	if (top != NULL) {
+		int donated = lock_hold_priority (heap_entry (top, struct lock_hold, elem));
+		if (donated > priority)
+			priority = donated;
 	}
+	return priority;
 }
-// Calculate and reset priority of thread t
-void thread_recalc_priority (struct thread *t) {
-	enum intr_level old_level = intr_disable ();
 
+// Calculate priority of thread t from its recent_cpu and nice, clamped to PRI_MIN..PRI_MAX
+static int
+thread_mlfqs_priority (struct thread *t) {
 	int fixed_recent_cpu_t = t->fixed_recent_cpu;
 	int fixed_nice_t = (t->nice) * fx_scale;
 
@@ -489,32 +1037,56 @@ void thread_recalc_priority (struct thread *t) {
 	int fixed_adj_nice = mult_fixeds (fixed_nice_t, 2 * fx_scale);
 
 	int new_priority = fxtor (PRI_MAX * fx_scale - fixed_adj_recent_cpu - fixed_adj_nice);
-	t->priority = new_priority;
-
-	intr_set_level (old_level);
+	if (new_priority < PRI_MIN)
+		new_priority = PRI_MIN;
+	else if (new_priority > PRI_MAX)
+		new_priority = PRI_MAX;
+	return new_priority;
 }
 
-// Calculate and reset priorities of all threads
-void thread_recalc_priority_all (void) {
-	if (list_empty (&thread_list))
+// Calculate and reset priority of thread t
+// Private note : the scheduler softirq may run in the idle thread, which is never queued by priority
+void thread_recalc_priority (struct thread *t) {
+	if (is_idle_thread (t))
 		return;
+	thread_set_effective_priority (t, thread_mlfqs_priority (t));
+}
 
-	struct list_elem *t_e = list_begin (&thread_list);
-	while (t_e != list_end (&thread_list)) {
-		struct thread *t = list_entry (t_e, struct thread, t_elem);
-		thread_recalc_priority (t);
-		t_e = list_next (t_e);
+// Recalculate priority of the thread running on each CPU, then have each CPU yield if its thread is no longer the highest
+// Private note : a ready thread never gets behind a running one, since only the running threads' recent_cpu grows
+void thread_recalc_priority_running (void) {
+	enum intr_level old_level = intr_disable ();
+
+	for (int i = 0; i < CPU_MAX; i++) {
+		struct cpu *c = &cpus[i];
+		struct runq *rq = cpu_rq (c);
+
+		if (!c->online)
+			continue;
+		thread_recalc_priority (c->curr);
+		if (c != cpu_current () && !is_idle_thread (c->curr) && rq->ready_mask != 0
+				&& c->curr->priority < ready_queue_max_priority (rq))
+			smp_send_resched (c);
 	}
+	thread_try_preemption ();
+
+	intr_set_level (old_level);
 }
 
 // Calculate and reset load_avg at the very time when function is called
 void thread_recalc_load_avg (void) {
 	enum intr_level old_level = intr_disable ();
 	
-	// The number of threads in ready_list and threads in executing at the time of update.
-	int fixed_num_ready_threads = (list_size (&ready_list) + 1) * fx_scale;
-	if (thread_current () == idle_thread)
-		fixed_num_ready_threads = 0;
+	// The number of threads in run queues and threads in executing at the time of update, over every CPU.
+	// A CPU running its idle thread has nothing ready, or is just about to pick it up, so it counts none.
+	int num_ready_threads = 0;
+	for (int i = 0; i < CPU_MAX; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (c->online && !is_idle_thread (c->curr))
+			num_ready_threads += cpu_rq (c)->ready_cnt + 1;
+	}
+	int fixed_num_ready_threads = num_ready_threads * fx_scale;
 
 	// Update fixed_load_avg
 	fixed_load_avg = mult_fixeds (fixed_w1, fixed_load_avg) + mult_fixeds (fixed_w2, fixed_num_ready_threads);
@@ -522,40 +1094,99 @@ void thread_recalc_load_avg (void) {
 	intr_set_level (old_level);
 }
 
-// Calculate and reset recent_cpu of thread t
+// Bring recent_cpu of thread t up to date, applying every once-per-second decay it has missed
+// Private note : blocked threads are not decayed on the second boundary. They catch up here when they are woken,
+// using the decay coefficients recorded in fixed_decay_hist. A thread never falls more than DECAY_HIST_SIZE
+// seconds behind, because thread_recalc_recent_cpu_runnable catches up the blocked threads whose oldest missed
+// coefficient is about to be overwritten, so every step is the exact per-second recurrence.
 void thread_recalc_recent_cpu (struct thread *t) {
 	enum intr_level old_level = intr_disable ();
 
+	int64_t missed = mlfqs_seconds - t->recent_cpu_seconds;
 	int fixed_recent_cpu_t = t->fixed_recent_cpu;
 	int fixed_nice_t = (t->nice) * fx_scale;
-	int fixed_decay = div_fixeds (mult_fixeds (fixed_load_avg, 2 * fx_scale), mult_fixeds (fixed_load_avg, 2 * fx_scale) + 1 * fx_scale);
-	int new_fixed_recent_cpu = mult_fixeds (fixed_decay, fixed_recent_cpu_t) + fixed_nice_t;
 
-	t->fixed_recent_cpu = new_fixed_recent_cpu;
+	ASSERT (missed <= DECAY_HIST_SIZE);
+	for (int64_t sec = mlfqs_seconds - missed + 1; sec <= mlfqs_seconds; sec++)
+		fixed_recent_cpu_t = mult_fixeds (fixed_decay_hist[sec % DECAY_HIST_SIZE], fixed_recent_cpu_t) + fixed_nice_t;
+
+	t->fixed_recent_cpu = fixed_recent_cpu_t;
+	t->recent_cpu_seconds = mlfqs_seconds;
 
 	intr_set_level (old_level);
 }
 
-// Calculate and reset recent_cpus of all threads
-void thread_recalc_recent_cpu_all (void) {
-	if (list_empty (&thread_list))
-		return;
+// Once per second : record this second's decay coefficient, then decay recent_cpu and recalculate priority
+// of the running thread and of the threads in the run queue. Blocked threads are left alone (see above),
+// except the ones DECAY_HIST_SIZE seconds behind, so each blocked thread is visited once every DECAY_HIST_SIZE seconds.
+void thread_recalc_recent_cpu_runnable (void) {
+	enum intr_level old_level = intr_disable ();
 
-	struct list_elem *t_e = list_begin (&thread_list);
-	while (t_e != list_end (&thread_list)) {
-		struct thread *t = list_entry (t_e, struct thread, t_elem);
-		thread_recalc_recent_cpu (t);
-		t_e = list_next (t_e);
+	int fixed_twice_load = mult_fixeds (fixed_load_avg, 2 * fx_scale);
+	mlfqs_seconds++;
+	fixed_decay_hist[mlfqs_seconds % DECAY_HIST_SIZE] = div_fixeds (fixed_twice_load, fixed_twice_load + 1 * fx_scale);
+
+	// The threads blocked since DECAY_HIST_SIZE seconds ago need the coefficient just overwritten.
+	// They are decayed up to now and stay in the same bucket
+	struct list *bucket = &decay_buckets[mlfqs_seconds % DECAY_HIST_SIZE];
+	for (struct list_elem *e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+		thread_recalc_recent_cpu (list_entry (e, struct thread, decay_elem));
+
+	for (int i = 0; i < CPU_MAX; i++) {
+		struct cpu *c = &cpus[i];
+		struct runq *rq = cpu_rq (c);
+
+		if (!c->online)
+			continue;
+		if (!is_idle_thread (c->curr)) {
+			thread_recalc_recent_cpu (c->curr);
+			thread_recalc_priority (c->curr);
+		}
+
+		// Take every ready thread out of the CPU's run queue, then requeue it at its new priority
+		struct list requeue;
+		list_init (&requeue);
+		spinlock_acquire (&rq->lock);
+		for (int pri = PRI_MAX; pri >= PRI_MIN; pri--)
+			if (!list_empty (&rq->ready_queues[pri]))
+				list_splice (list_end (&requeue), list_begin (&rq->ready_queues[pri]), list_end (&rq->ready_queues[pri]));
+		rq->ready_mask = 0;
+		rq->ready_cnt -= list_size (&requeue);
+		spinlock_release (&rq->lock);
+
+		while (!list_empty (&requeue)) {
+			struct thread *t = list_entry (list_pop_front (&requeue), struct thread, elem);
+			thread_recalc_recent_cpu (t);
+			t->priority = thread_mlfqs_priority (t);
+			ready_queue_push (t);
+		}
 	}
+
+	intr_set_level (old_level);
 }
 
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, clamped to
+   [NICE_MIN, NICE_MAX]. */
 void
 thread_set_nice (int nice) {
 	enum intr_level old_level = intr_disable ();
 
+	if (nice < NICE_MIN)
+		nice = NICE_MIN;
+	else if (nice > NICE_MAX)
+		nice = NICE_MAX;
+
+	// For cfs
+	// Charge the time run so far at the old weight. The new weight only changes how fast vruntime grows.
+	if (thread_cfs)
+		cfs_update_curr (thread_current ());
 	thread_current ()->nice = nice;
+	// For mlfqs
+	// Recalculate priority of current thread right away, and yield if it is no longer the highest
+	if (thread_mlfqs)
+		thread_recalc_priority (thread_current ());
+	thread_try_preemption ();
 
 	intr_set_level (old_level);
 }
@@ -580,25 +1211,46 @@ thread_get_recent_cpu (void) {
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   The idle thread of the BSP is initially put on the ready list
+   by thread_start().  It will be scheduled once initially, at
+   which point it initializes idle_thread, "up"s the semaphore
+   passed to it to enable thread_start() to continue, and
+   immediately blocks.  After that, the idle thread never appears
+   in the run queue.  It is returned by next_thread_to_run() as a
+   special case when the run queue is empty.  Each application
+   processor runs its own idle thread from thread_start_ap(),
+   with a null IDLE_STARTED. */
 static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
-	sema_up (idle_started);
+	cpu_current ()->idle_thread = thread_current ();
+	if (idle_started != NULL)
+		sema_up (idle_started);
 
 	for (;;) {
-		/* Let someone else run. */
+		/* Catch up on ticks skipped while halted, run the softirqs
+		   they raised, then let someone else run. */
 		intr_disable ();
+		timer_idle_exit ();
+		softirq_run ();
 		thread_block ();
 
+		/* Nothing to run.  Rather than halt right away, zero a
+		   free page for later PAL_ZERO allocations, with
+		   interrupts on, and look again.  Only one page at a
+		   time: a thread woken meanwhile does not preempt us. */
+		intr_enable ();
+		if (palloc_zero_idle ())
+			continue;
+		intr_disable ();
+		if (thread_rq (thread_current ())->ready_cnt > 0)
+			continue;
+
+		/* In tickless mode, stop the periodic tick until the
+		   next timer deadline. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -610,7 +1262,11 @@ idle (void *idle_started_ UNUSED) {
 		   time.
 
 		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-		   7.11.1 "HLT Instruction". */
+		   7.11.1 "HLT Instruction".
+
+		   Interrupts go on without intr_enable(), so the interrupt
+		   lock must be released by hand. */
+		intr_lock_release ();
 		asm volatile ("sti; hlt" : : : "memory");
 	}
 }
@@ -626,6 +1282,49 @@ kernel_thread (thread_func *function, void *aux) {
 }
 
 
+/* Returns a page for a new thread, from the page cache if it has
+   one, or else from the page allocator.  The page is not zeroed,
+   since init_thread() clears the struct thread and the stack needs
+   no clearing.  Returns a null pointer if no page is available. */
+static struct thread *
+thread_page_get (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (!list_empty (&thread_page_cache)) {
+		t = list_entry (list_pop_front (&thread_page_cache), struct thread, elem);
+		thread_page_cache_cnt--;
+	}
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Frees the cached pages of the threads that died first,
+   until there is room for one more page.  May be called with
+   interrupts on or off. */
+static void
+thread_page_trim (void) {
+	for (;;) {
+		enum intr_level old_level;
+		struct thread *t;
+
+		old_level = intr_disable ();
+		if (thread_page_cache_cnt < THREAD_PAGE_CACHE_MAX) {
+			intr_set_level (old_level);
+			break;
+		}
+		t = list_entry (list_pop_back (&thread_page_cache), struct thread, elem);
+		thread_page_cache_cnt--;
+		intr_set_level (old_level);
+
+		palloc_free_page (t);
+	}
+}
+
 /* Does basic initialization of T as a blocked thread named
    NAME. */
 static void
@@ -643,32 +1342,407 @@ init_thread (struct thread *t, const char *name, int priority) {
 
 	// privately added
 	t->original_priority = priority;
-	list_init (&t->donor_list);
+	heap_init (&t->held_locks, cmp_priority_greater_lock, NULL);
 	t->lock_waiting = NULL;
+	t->rwlock_waiting = NULL;
+	for (int i = 0; i < RWLOCK_READ_MAX; i++)
+		t->rw_reads[i].rwlock = NULL;
+	t->waitq = NULL;
+	timer_setup (&t->sleep_timer, thread_sleep_expired, t);
 
-	t->nice = 0;
+	t->nice = NICE_DEFAULT;
 	t->fixed_recent_cpu = 0;
-	list_push_back (&thread_list, &t->t_elem);
+	t->recent_cpu_seconds = mlfqs_seconds;
+
+	t->cpu = cpu_current ();
+	t->vruntime = thread_rq (t)->cfs_min_vruntime;
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   will be in the run queue.)  If the run queue of this CPU is
+   empty, take a thread from another CPU's, and if there is none
+   to take, return idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
+	struct cpu *c = cpu_current ();
+	struct runq *rq = cpu_rq (c);
+
+	if (!rb_empty (&rq->edf_queue)) {
+		struct thread *t = rb_entry (rb_first (&rq->edf_queue), struct thread, dl_elem);
+		ready_queue_remove (t);
+		return t;
+	} else if (rq->ready_cnt == 0 && !thread_steal ())
+		return c->idle_thread;
+	else if (thread_cfs) {
+		struct thread *t = rb_entry (rb_first (&rq->cfs_queue), struct thread, cfs_elem);
+		ready_queue_remove (t);
+		return t;
+	} else {
+		struct list *q = &rq->ready_queues[ready_queue_max_priority (rq)];
+		struct thread *t = list_entry (list_front (q), struct thread, elem);
+		ready_queue_remove (t);
+		return t;
+	}
+}
+
+/* Appends T to the run queue of its current priority, or, for
+   the CFS, inserts it in order of vruntime.  A deadline thread
+   goes to the EDF run queue instead, in order of deadline.  The
+   run queue is the one of T's CPU.  Must be called with
+   interrupts off. */
+static void
+ready_queue_push (struct thread *t) {
+	struct runq *rq = thread_rq (t);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	spinlock_acquire (&rq->lock);
+	if (t->dl_period != 0) {
+		rb_insert (&rq->edf_queue, &t->dl_elem);
+		rq->dl_cnt++;
+	} else if (thread_cfs) {
+		// A yielding thread is charged before it is queued, since its key must not change in the tree
+		if (t == running_thread ())
+			cfs_update_curr (t);
+		rb_insert (&rq->cfs_queue, &t->cfs_elem);
+		rq->cfs_load += cfs_weight (t);
+	} else {
+		list_push_back (&rq->ready_queues[t->priority], &t->elem);
+		rq->ready_mask |= 1ULL << t->priority;
+	}
+	rq->ready_cnt++;
+	spinlock_release (&rq->lock);
+}
+
+/* Removes T, which must be queued at its current priority, from
+   the run queue of its CPU.  Must be called with interrupts
+   off. */
+static void
+ready_queue_remove (struct thread *t) {
+	struct runq *rq = thread_rq (t);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spinlock_acquire (&rq->lock);
+	if (t->dl_period != 0) {
+		rb_remove (&rq->edf_queue, &t->dl_elem);
+		rq->dl_cnt--;
+	} else if (thread_cfs) {
+		rb_remove (&rq->cfs_queue, &t->cfs_elem);
+		rq->cfs_load -= cfs_weight (t);
+	} else {
+		list_remove (&t->elem);
+		if (list_empty (&rq->ready_queues[t->priority]))
+			rq->ready_mask &= ~(1ULL << t->priority);
+	}
+	rq->ready_cnt--;
+	spinlock_release (&rq->lock);
+}
+
+/* Returns the CPU to run T on, now that it is ready: T's own CPU
+   if T is a deadline thread, which never moves, or if that CPU
+   is idle; else any idle CPU; else, for priority scheduling, the
+   CPU running the lowest priority thread, if T would preempt it;
+   else T's own CPU.  Threads left waiting behind busier CPUs are
+   moved later by thread_balance(). */
+static struct cpu *
+thread_select_cpu (struct thread *t) {
+	struct cpu *lowest = NULL;
+
+	if (t->dl_period != 0 || cpu_load (t->cpu) == 0)
+		return t->cpu;
+	for (int i = 0; i < CPU_MAX; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (!c->online)
+			continue;
+		if (cpu_load (c) == 0)
+			return c;
+		if (!thread_cfs && c->curr->dl_period == 0 && c->curr->priority < t->priority
+				&& (lowest == NULL || c->curr->priority < lowest->curr->priority))
+			lowest = c;
+	}
+	return lowest != NULL ? lowest : t->cpu;
+}
+
+/* Moves T, which is in no run queue, over to CPU C.  For the
+   CFS, T keeps its vruntime relative to the minimum vruntime of
+   the run queue, since each CPU's minimum advances on its own. */
+static void
+thread_migrate (struct thread *t, struct cpu *c) {
+	ASSERT (t->dl_period == 0 || t->cpu == c);
+
+	if (t->cpu == c)
+		return;
+	t->vruntime += cpu_rq (c)->cfs_min_vruntime - thread_rq (t)->cfs_min_vruntime;
+	t->cpu = c;
+}
+
+/* Returns the number of threads that are ready or running on C,
+   not counting its idle thread. */
+static int
+cpu_load (struct cpu *c) {
+	return cpu_rq (c)->ready_cnt + (is_idle_thread (c->curr) ? 0 : 1);
+}
+
+/* Returns the online CPU other than SELF with the highest load
+   among the ones with a ready thread that may move, or a null
+   pointer if there is none. */
+static struct cpu *
+cpu_busiest (struct cpu *self) {
+	struct cpu *busiest = NULL;
+
+	for (int i = 0; i < CPU_MAX; i++) {
+		struct cpu *c = &cpus[i];
+		struct runq *rq = cpu_rq (c);
+
+		if (c == self || !c->online || rq->ready_cnt == rq->dl_cnt)
+			continue;
+		if (busiest == NULL || cpu_load (c) > cpu_load (busiest))
+			busiest = c;
+	}
+	return busiest;
+}
+
+/* Moves the ready thread of SRC that would run first there,
+   other than a deadline thread, to the run queue of DST.  SRC
+   must have such a thread. */
+static void
+thread_pull (struct cpu *src, struct cpu *dst) {
+	struct runq *rq = cpu_rq (src);
+	struct thread *t;
+
+	if (thread_cfs)
+		t = rb_entry (rb_first (&rq->cfs_queue), struct thread, cfs_elem);
 	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+		t = list_entry (list_front (&rq->ready_queues[ready_queue_max_priority (rq)]),
+				struct thread, elem);
+	ready_queue_remove (t);
+	thread_migrate (t, dst);
+	ready_queue_push (t);
+}
+
+/* Takes a ready thread from the busiest CPU for the running CPU,
+   which has nothing to run.  Returns false if no other CPU has a
+   thread to take. */
+static bool
+thread_steal (void) {
+	struct cpu *self = cpu_current ();
+	struct cpu *busiest = cpu_busiest (self);
+
+	if (busiest == NULL)
+		return false;
+	thread_pull (busiest, self);
+	return true;
+}
+
+/* Pulls ready threads from the busiest CPU for the running CPU,
+   until their loads differ by at most one.  Returns true if any
+   thread was moved. */
+static bool
+thread_balance (void) {
+	struct cpu *self = cpu_current ();
+	struct cpu *busiest = cpu_busiest (self);
+	bool moved = false;
+
+	if (busiest == NULL)
+		return false;
+	while (cpu_rq (busiest)->ready_cnt > cpu_rq (busiest)->dl_cnt
+			&& cpu_load (busiest) - cpu_load (self) > 1) {
+		thread_pull (busiest, self);
+		moved = true;
+	}
+	return moved;
+}
+
+/* Returns the online CPU with the least deadline utilization that
+   can still admit a deadline thread of DENSITY, or a null pointer
+   if none can. */
+static struct cpu *
+dl_admit (int64_t density) {
+	struct cpu *best = NULL;
+
+	for (int i = 0; i < CPU_MAX; i++) {
+		struct cpu *c = &cpus[i];
+		struct runq *rq = cpu_rq (c);
+
+		if (!c->online || rq->dl_util + density > DL_UTIL_MAX)
+			continue;
+		if (best == NULL || rq->dl_util < cpu_rq (best)->dl_util)
+			best = c;
+	}
+	return best;
+}
+
+/* Orders threads in the EDF run queue by absolute deadline. */
+static bool
+edf_less (const struct rb_elem *a_, const struct rb_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = rb_entry (a_, struct thread, dl_elem);
+	const struct thread *b = rb_entry (b_, struct thread, dl_elem);
+
+	return a->dl_deadline < b->dl_deadline;
 }
 
-/* Use iretq to launch the thread */
+/* Returns the weight of T's nice value for the CFS. */
+static int
+cfs_weight (const struct thread *t) {
+	ASSERT (NICE_MIN <= t->nice && t->nice <= NICE_MAX);
+	return cfs_nice_weight[t->nice - NICE_MIN];
+}
+
+/* Orders threads in the CFS run queue by vruntime. */
+static bool
+cfs_less (const struct rb_elem *a_, const struct rb_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = rb_entry (a_, struct thread, cfs_elem);
+	const struct thread *b = rb_entry (b_, struct thread, cfs_elem);
+
+	return a->vruntime < b->vruntime;
+}
+
+/* Charges CURR, which must not be in the CFS run queue, for the
+   time it ran since it was last charged, scaled by its weight,
+   and advances the minimum vruntime.  Must be called with
+   interrupts off. */
+static void
+cfs_update_curr (struct thread *curr) {
+	struct runq *rq = thread_rq (curr);
+	int64_t now = timer_ns ();
+	int64_t min_vruntime;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (is_idle_thread (curr) || curr->dl_period != 0)
+		return;
+	if (now > curr->exec_start)
+		curr->vruntime += (now - curr->exec_start) * CFS_NICE_0_WEIGHT / cfs_weight (curr);
+	curr->exec_start = now;
+
+	min_vruntime = curr->vruntime;
+	if (!rb_empty (&rq->cfs_queue)) {
+		struct thread *first = rb_entry (rb_first (&rq->cfs_queue), struct thread, cfs_elem);
+		if (first->vruntime < min_vruntime)
+			min_vruntime = first->vruntime;
+	}
+	if (min_vruntime > rq->cfs_min_vruntime)
+		rq->cfs_min_vruntime = min_vruntime;
+}
+
+/* Returns the time in ns that T, which is running, may run before
+   it is preempted: its share of the latency period by weight.  The
+   period is stretched when there are too many runnable threads to
+   give each of them the minimum granularity. */
+static int64_t
+cfs_slice (const struct thread *t) {
+	struct runq *rq = thread_rq (t);
+	int64_t period = CFS_LATENCY_NS;
+	int64_t slice;
+
+	if ((int64_t) (rq->ready_cnt + 1) * CFS_MIN_GRANULARITY_NS > period)
+		period = (int64_t) (rq->ready_cnt + 1) * CFS_MIN_GRANULARITY_NS;
+	slice = period * cfs_weight (t) / (rq->cfs_load + cfs_weight (t));
+	return slice > CFS_MIN_GRANULARITY_NS ? slice : CFS_MIN_GRANULARITY_NS;
+}
+
+/* Returns true if T, which is running and was just charged, should
+   give up the CPU at this tick: it has used its slice, or it has
+   run for the minimum granularity and is more than a slice ahead
+   of the leftmost ready thread. */
+static bool
+cfs_tick_preempt (struct thread *t) {
+	struct runq *rq = thread_rq (t);
+	int64_t ran = t->exec_start - t->slice_start;
+	int64_t slice;
+	struct thread *first;
+
+	if (rq->ready_cnt == 0)
+		return false;
+	slice = cfs_slice (t);
+	if (ran >= slice)
+		return true;
+	if (ran < CFS_MIN_GRANULARITY_NS)
+		return false;
+	first = rb_entry (rb_first (&rq->cfs_queue), struct thread, cfs_elem);
+	return t->vruntime - first->vruntime > slice;
+}
+
+/* Returns the highest priority among ready threads of RQ.
+   RQ must have a ready thread outside its EDF run queue. */
+static int
+ready_queue_max_priority (struct runq *rq) {
+	ASSERT (rq->ready_mask != 0);
+	return 63 - __builtin_clzll (rq->ready_mask);
+}
+
+/* Sets T's effective priority to PRIORITY.  If T is in the run
+   queue, it is moved to the tail of the queue for PRIORITY.  If
+   T is in a semaphore's or condition's wait queue, its place
+   there is updated too.
+
+   If T is waiting for a lock, the change may alter the lock's
+   highest waiter, so the holder's priority is recomputed in turn,
+   and so on up the chain of holders until a priority stays the
+   same.  There is no limit on the depth of the chain.  If T is
+   waiting for an rwlock, the same happens for each holder. */
+static void
+thread_set_effective_priority (struct thread *t, int priority) {
+	enum intr_level old_level = intr_disable ();
+
+	while (t->priority != priority) {
+		struct lock *lock = t->lock_waiting;
+		struct rwlock *rwlock = t->rwlock_waiting;
+
+		if (t->status == THREAD_READY) {
+			ready_queue_remove (t);
+			t->priority = priority;
+			ready_queue_push (t);
+			// For multiprocessors
+			// T may now preempt the thread running on its CPU, which checks for itself
+			smp_send_resched (t->cpu);
+		} else
+			t->priority = priority;
+		waitq_reprioritize (t);
+
+		// for priority donation
+		// an rwlock may have several holders, so each of them gets its own walk up the chain
+		if (rwlock != NULL && t->waitq == &rwlock->waiters) {
+			rwlock_donate (rwlock);
+			break;
+		}
+		// T may have been woken but not yet retaken the lock, in which case it donates nothing
+		if (lock == NULL || lock->holder == NULL || t->waitq != &lock->semaphore.waiters)
+			break;
+		t = lock->holder;
+		heap_update (&t->held_locks, &lock->hold.elem);
+		priority = thread_effective_priority (t);
+	}
+
+	intr_set_level (old_level);
+}
+
+/* Use iretq to launch the thread.
+
+   If iretq turns interrupts on, the interrupt lock is released
+   by hand, since intr_enable() is not involved.  That must wait
+   until we are off the old stack, which may be the page of a
+   dying thread, free for another CPU to reuse once the lock is
+   released. */
 void
 do_iret (struct intr_frame *tf) {
+	volatile int *lock = NULL;
+
+	if (intr_get_level () == INTR_OFF && (tf->eflags & FLAG_IF))
+		lock = &intr_lock;
 	__asm __volatile(
 			"movq %0, %%rsp\n"
+			"testq %1, %1\n"
+			"jz 1f\n"
+			"movl $0, (%1)\n"
+			"1:\n"
 			"movq 0(%%rsp),%%r15\n"
 			"movq 8(%%rsp),%%r14\n"
 			"movq 16(%%rsp),%%r13\n"
@@ -689,7 +1763,7 @@ do_iret (struct intr_frame *tf) {
 			"movw (%%rsp),%%es\n"
 			"addq $32, %%rsp\n"
 			"iretq"
-			: : "g" ((uint64_t) tf) : "memory");
+			: : "g" ((uint64_t) tf), "r" (lock) : "memory");
 }
 
 /* Switching the thread by activating the new thread's page
@@ -704,61 +1778,15 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+	/* Both threads are in kernel mode, so thread_switch() saves
+	 * only the callee-saved registers and the stack pointer,
+	 * instead of a whole intr_frame.  A thread that has never run
+	 * has no such context yet and starts from its intr_frame
+	 * through do_iret; user mode is entered and left through
+	 * intr_frames as well, never through here. */
+	thread_switch (&running_thread ()->switch_rsp, th->switch_rsp, &th->tf);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -769,28 +1797,34 @@ static void
 do_schedule(int status) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (thread_current()->status == THREAD_RUNNING);
-	while (!list_empty (&destruction_req)) {
-		struct thread *victim =
-			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
-	}
 	thread_current ()->status = status;
 	schedule ();
 }
 
 static void
 schedule (void) {
+	struct cpu *c = cpu_current ();
 	struct thread *curr = running_thread ();
 	struct thread *next = next_thread_to_run ();
 
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
+	ASSERT (next->cpu == c);
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
+	c->curr = next;
+
+	// For cfs
+	// Charge the thread we switch from, unless it is already back in the run queue, and start the slice of the next
+	if (thread_cfs) {
+		if (curr->status != THREAD_READY)
+			cfs_update_curr (curr);
+		next->exec_start = next->slice_start = timer_ns ();
+	}
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	c->thread_ticks = 0;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -798,16 +1832,17 @@ schedule (void) {
 #endif
 
 	if (curr != next) {
-		/* If the thread we switched from is dying, destroy its struct
-		   thread. This must happen late so that thread_exit() doesn't
-		   pull out the rug under itself.
-		   We just queuing the page free request here because the page is
-		   currently used by the stack.
-		   The real destruction logic will be called at the beginning of the
-		   schedule(). */
+		/* If the thread we switched from is dying, hand its page to
+		   the page cache.  This must happen late so that
+		   thread_exit() doesn't pull out the rug under itself: the
+		   page is still our stack until thread_launch() switches
+		   away from it, which is fine since nothing can take it from
+		   the cache before then. */
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
 			ASSERT (curr != next);
-			list_push_back (&destruction_req, &curr->elem);
+			ASSERT (thread_page_cache_cnt < THREAD_PAGE_CACHE_MAX);
+			list_push_front (&thread_page_cache, &curr->elem);
+			thread_page_cache_cnt++;
 		}
 
 		/* Before switching the thread, we first save the information
@@ -829,19 +1864,11 @@ allocate_tid (void) {
 	return tid;
 }
 
-// Given list elem e1 and e2, returns true if t1->priority is greater than t2->priority
-bool 
-cmp_priority_greater (struct list_elem *e1, struct list_elem *e2) {
-	struct thread *t1 = list_entry (e1, struct thread, elem);
-	struct thread *t2 = list_entry (e2, struct thread, elem);
-	return (t1->priority > t2->priority);
+// Given heap elem e1 and e2 of held locks, returns true if the highest waiter of h1 has greater priority than that of h2
+// Adapted for 'held_locks'
+static bool
+cmp_priority_greater_lock (const struct heap_elem *e1, const struct heap_elem *e2, void *aux UNUSED) {
+	struct lock_hold *h1 = heap_entry (e1, struct lock_hold, elem);
+	struct lock_hold *h2 = heap_entry (e2, struct lock_hold, elem);
+	return (lock_hold_priority (h1) > lock_hold_priority (h2));
 }
-
-// Given list elem e1 and e2, returns true if t1->priority is greater than t2->priority
-// Adpated for 'donor_list' and 'd_elem'
-bool
-cmp_priority_greater_dona (struct list_elem *e1, struct list_elem *e2) {
-	struct thread *t1 = list_entry (e1, struct thread, d_elem);
-	struct thread *t2 = list_entry (e2, struct thread, d_elem);
-	return (t1->priority > t2->priority);
-}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+static thread_func worker_main;
+
+/* Initializes WQ and starts WORKER_CNT threads named NAME at
+   PRIORITY to run its work.  Returns true if successful, false if
+   no worker could be created.  (If only some could, WQ works
+   with those.) */
+bool
+workqueue_create (struct workqueue *wq, const char *name,
+		int priority, int worker_cnt) {
+	int created = 0;
+	int i;
+
+	ASSERT (wq != NULL);
+	ASSERT (name != NULL);
+	ASSERT (worker_cnt > 0);
+
+	wq->name = name;
+	list_init (&wq->works);
+	sema_init (&wq->ready, 0);
+	wq->busy = 0;
+	waitq_init (&wq->flushers);
+
+	for (i = 0; i < worker_cnt; i++)
+		if (thread_create (name, priority, worker_main, wq) != TID_ERROR)
+			created++;
+	return created > 0;
+}
+
+/* Waits until WQ has no pending or running work.  Must not be
+   called by one of WQ's own workers. */
+void
+workqueue_flush (struct workqueue *wq) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	while (wq->busy > 0) {
+		waitq_push (&wq->flushers, thread_current ());
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Initializes WORK to call FUNC (AUX) once queued. */
+void
+work_init (struct work *work, work_func *func, void *aux) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->aux = aux;
+	work->pending = false;
+}
+
+/* Queues WORK on WQ, unless it is already pending.  Returns true
+   if WORK was queued, false if it was pending.  WORK may be
+   queued again once it has started running.
+
+   This function may be called from an interrupt handler. */
+bool
+work_queue (struct workqueue *wq, struct work *work) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	old_level = intr_disable ();
+	if (!work->pending) {
+		work->pending = true;
+		list_push_back (&wq->works, &work->elem);
+		wq->busy++;
+		sema_up (&wq->ready);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Takes WORK off WQ if it has not started yet.  Returns true if
+   it was pending, false otherwise.  Does not wait for WORK if it
+   is running.
+
+   This function may be called from an interrupt handler. */
+bool
+work_cancel (struct workqueue *wq, struct work *work) {
+	enum intr_level old_level;
+	bool was_pending;
+
+	old_level = intr_disable ();
+	was_pending = work->pending;
+	if (was_pending) {
+		work->pending = false;
+		list_remove (&work->elem);
+		/* A worker may already be on its way to this work; it will
+		   find the list shorter and go back to sleep. */
+		sema_try_down (&wq->ready);
+		if (--wq->busy == 0)
+			while (!waitq_empty (&wq->flushers))
+				thread_unblock (waitq_pop (&wq->flushers));
+	}
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Worker thread: runs the work queued on WQ_, one at a time,
+   with interrupts on. */
+static void
+worker_main (void *wq_) {
+	struct workqueue *wq = wq_;
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *work;
+
+		sema_down (&wq->ready);
+
+		old_level = intr_disable ();
+		if (list_empty (&wq->works)) {
+			intr_set_level (old_level);
+			continue;
+		}
+		work = list_entry (list_pop_front (&wq->works), struct work, elem);
+		work->pending = false;
+		intr_set_level (old_level);
+
+		work->func (work->aux);
+
+		old_level = intr_disable ();
+		if (--wq->busy == 0)
+			while (!waitq_empty (&wq->flushers))
+				thread_unblock (waitq_pop (&wq->flushers));
+		intr_set_level (old_level);
+	}
+}
@@ -61,7 +61,7 @@ struct segment_descriptor64 {
 	type, 1, dpl, 1, (unsigned) (lim) >> 28, 0, 1, 0, 1, \
 	(unsigned) (base) >> 24 }
 
-static struct segment_desc gdt[SEL_CNT] = {
+static struct segment_desc gdt[SEL_CNT + 2 * (CPU_MAX - 1)] = {
 	[SEL_NULL >> 3] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 	[SEL_KCSEG >> 3] = SEG64 (0xa, 0x0, 0xffffffff, 0),
 	[SEL_KDSEG >> 3] = SEG64 (0x2, 0x0, 0xffffffff, 0),
@@ -78,12 +78,14 @@ struct desc_ptr gdt_ds = {
 };
 
 /* Sets up a proper GDT.  The bootstrap loader's GDT didn't
-   include user-mode selectors or a TSS, but we need both now. */
+   include user-mode selectors or a TSS, but we need both now.
+   Each CPU calls this once, to add its own TSS and load the
+   GDT. */
 void
 gdt_init (void) {
 	/* Initialize GDT. */
 	struct segment_descriptor64 *tss_desc =
-		(struct segment_descriptor64 *) &gdt[SEL_TSS >> 3];
+		(struct segment_descriptor64 *) &gdt[SEL_TSS_CPU (cpu_current ()->id) >> 3];
 	struct task_state *tss = tss_get ();
 
 	*tss_desc = (struct segment_descriptor64) {
@@ -11,9 +11,12 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
+#include "threads/futex.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -22,10 +25,55 @@
 #include "vm/vm.h"
 #endif
 
+/* A user process: one address space shared by one or more
+   threads.  Each thread is an ordinary kernel-scheduled thread
+   with its own user stack region; the last one to leave the
+   process destroys the address space. */
+struct process {
+	struct lock lock;           /* Protects the members below. */
+	uint64_t *pml4;             /* Shared page map level 4. */
+	struct list threads;        /* Started threads, via proc_elem. */
+	int thread_cnt;             /* Threads created and not yet left. */
+	struct list exits;          /* Exit records not yet joined or freed. */
+	uint32_t stack_slots;       /* Bitmap of user stack regions in use. */
+	bool exiting;               /* Whole process is exiting. */
+};
+
+/* Exit status of one thread of a process, kept until another
+   thread of the process joins it.  The record of a detached
+   thread is freed as soon as the thread exits instead. */
+struct exit_record {
+	tid_t tid;                  /* Thread's id. */
+	int status;                 /* Exit status, once it has exited. */
+	bool exited;                /* Has the thread left the process? */
+	bool joined;                /* Some thread is waiting for it. */
+	bool detached;              /* No thread will ever join it. */
+	struct semaphore dead;      /* Upped when the thread leaves. */
+	struct list_elem elem;      /* Element in process's exits. */
+};
+
+/* What a new thread of a process needs to start running. */
+struct user_thread_args {
+	struct process *process;
+	struct exit_record *rec;
+	int stack_slot;
+	struct intr_frame if_;
+};
+
+/* Each thread's user stack lives in its own region of this many
+   bytes, counting down from USER_STACK.  Region 0 belongs to the
+   thread that loaded the program. */
+#define STACK_REGION_SIZE (1 << 20)
+#define STACK_REGION_CNT 32
+
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static bool process_start (struct thread *);
+static void process_leave (int status);
+static void process_kill (struct process *);
+static void start_user_thread (void *);
 
 /* General process initializer for initd and other process. */
 static void
@@ -228,6 +276,14 @@ process_cleanup (void) {
 	supplemental_page_table_kill (&curr->spt);
 #endif
 
+	/* Take the rest of the process down with us.  Unless we are
+	   the last thread out, the address space stays with the
+	   others. */
+	if (curr->process != NULL) {
+		process_kill (curr->process);
+		process_leave (-1);
+	}
+
 	uint64_t *pml4;
 	/* Destroy the current process's page directory and switch back
 	 * to the kernel-only page directory. */
@@ -246,6 +302,325 @@ process_cleanup (void) {
 	}
 }
 
+/* Makes T, which has just created its page map, the first
+   thread of a new process.  Returns true if successful, false
+   on memory allocation failure. */
+static bool
+process_start (struct thread *t) {
+	struct process *p = malloc (sizeof *p);
+	struct exit_record *rec = malloc (sizeof *rec);
+
+	if (p == NULL || rec == NULL) {
+		free (p);
+		free (rec);
+		return false;
+	}
+
+	lock_init (&p->lock);
+	p->pml4 = t->pml4;
+	list_init (&p->threads);
+	list_push_back (&p->threads, &t->proc_elem);
+	p->thread_cnt = 1;
+	list_init (&p->exits);
+	p->stack_slots = 1;
+	p->exiting = false;
+
+	rec->tid = t->tid;
+	rec->status = -1;
+	rec->exited = false;
+	rec->joined = false;
+	rec->detached = false;
+	sema_init (&rec->dead, 0);
+	list_push_back (&p->exits, &rec->elem);
+
+	t->process = p;
+	t->exit_rec = rec;
+	t->stack_slot = 0;
+	return true;
+}
+
+/* Returns the user page at the top of stack region SLOT. */
+static void *
+stack_page (int slot) {
+	return (uint8_t *) USER_STACK - slot * STACK_REGION_SIZE - PGSIZE;
+}
+
+/* Starts a new thread in the running process, with its own user
+   stack, that enters user mode at ENTRY with ARG0 and ARG1 as its
+   first two arguments.  Returns the new thread's id, or TID_ERROR
+   if the thread cannot be created. */
+tid_t
+process_thread_create (uintptr_t entry, uint64_t arg0, uint64_t arg1) {
+	struct process *p = thread_current ()->process;
+	struct user_thread_args *start = NULL;
+	struct exit_record *rec = NULL;
+	uint8_t *kpage = NULL;
+	tid_t tid = TID_ERROR;
+	int slot;
+
+	if (p == NULL || !is_user_vaddr ((void *) entry))
+		return TID_ERROR;
+
+	start = malloc (sizeof *start);
+	rec = malloc (sizeof *rec);
+	kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+	if (start == NULL || rec == NULL || kpage == NULL)
+		goto done;
+
+	/* Holding the lock across thread_create() keeps the new thread
+	   from joining the process before its exit record is listed. */
+	lock_acquire (&p->lock);
+	for (slot = 0; slot < STACK_REGION_CNT; slot++)
+		if ((p->stack_slots & (1u << slot)) == 0)
+			break;
+	if (p->exiting || slot == STACK_REGION_CNT
+			|| !pml4_set_page (p->pml4, stack_page (slot), kpage, true)) {
+		lock_release (&p->lock);
+		goto done;
+	}
+
+	rec->status = -1;
+	rec->exited = false;
+	rec->joined = false;
+	rec->detached = false;
+	sema_init (&rec->dead, 0);
+
+	start->process = p;
+	start->rec = rec;
+	start->stack_slot = slot;
+	memset (&start->if_, 0, sizeof start->if_);
+	start->if_.ds = start->if_.es = start->if_.ss = SEL_UDSEG;
+	start->if_.cs = SEL_UCSEG;
+	start->if_.eflags = FLAG_IF | FLAG_MBS;
+	start->if_.rip = entry;
+	start->if_.R.rdi = arg0;
+	start->if_.R.rsi = arg1;
+	/* As if ENTRY had been called: a (null) return address on top
+	   of a 16-byte aligned stack. */
+	start->if_.rsp = (uintptr_t) stack_page (slot) + PGSIZE - sizeof (void *);
+
+	tid = thread_create (thread_name (), thread_get_priority (),
+			start_user_thread, start);
+	if (tid == TID_ERROR) {
+		pml4_clear_page (p->pml4, stack_page (slot));
+		lock_release (&p->lock);
+		goto done;
+	}
+	rec->tid = tid;
+	list_push_back (&p->exits, &rec->elem);
+	p->stack_slots |= 1u << slot;
+	p->thread_cnt++;
+	lock_release (&p->lock);
+	return tid;
+
+done:
+	free (start);
+	free (rec);
+	palloc_free_page (kpage);
+	return TID_ERROR;
+}
+
+/* A thread function that enters user mode in a thread created by
+   process_thread_create(). */
+static void
+start_user_thread (void *start_) {
+	struct user_thread_args *start = start_;
+	struct thread *curr = thread_current ();
+	struct process *p = start->process;
+	struct intr_frame if_ = start->if_;
+
+	curr->exit_rec = start->rec;
+	curr->stack_slot = start->stack_slot;
+	free (start);
+
+	lock_acquire (&p->lock);
+	curr->process = p;
+	curr->pml4 = p->pml4;
+	list_push_back (&p->threads, &curr->proc_elem);
+	lock_release (&p->lock);
+	process_activate (curr);
+#ifdef VM
+	supplemental_page_table_init (&curr->spt);
+#endif
+
+	process_init ();
+
+	if (process_exiting ())
+		thread_exit ();
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* Waits for thread TID of the running process to exit and returns
+   the status it passed to process_thread_exit(), or -1 if it was
+   killed.  Returns -1 immediately if TID is not a thread of this
+   process, is the caller, is detached, or is already being
+   joined. */
+int
+process_thread_join (tid_t tid) {
+	struct thread *curr = thread_current ();
+	struct process *p = curr->process;
+	struct exit_record *rec = NULL;
+	struct list_elem *e;
+	int status;
+
+	if (p == NULL)
+		return -1;
+
+	lock_acquire (&p->lock);
+	for (e = list_begin (&p->exits); e != list_end (&p->exits);
+			e = list_next (e)) {
+		struct exit_record *r = list_entry (e, struct exit_record, elem);
+
+		if (r->tid == tid) {
+			if (!r->joined && !r->detached && r != curr->exit_rec) {
+				r->joined = true;
+				rec = r;
+			}
+			break;
+		}
+	}
+	lock_release (&p->lock);
+	if (rec == NULL)
+		return -1;
+
+	sema_down (&rec->dead);
+
+	lock_acquire (&p->lock);
+	list_remove (&rec->elem);
+	lock_release (&p->lock);
+	status = rec->status;
+	free (rec);
+	return status;
+}
+
+/* Detaches thread TID of the running process, which may be the
+   caller: no thread will join it, and its exit status is thrown
+   away as soon as it exits, rather than kept until the process
+   exits.  Returns 0 if successful, or -1 if TID is not a thread of
+   this process or is already being joined or detached. */
+int
+process_thread_detach (tid_t tid) {
+	struct process *p = thread_current ()->process;
+	struct list_elem *e;
+	int result = -1;
+
+	if (p == NULL)
+		return -1;
+
+	lock_acquire (&p->lock);
+	for (e = list_begin (&p->exits); e != list_end (&p->exits);
+			e = list_next (e)) {
+		struct exit_record *r = list_entry (e, struct exit_record, elem);
+
+		if (r->tid == tid) {
+			if (!r->joined && !r->detached) {
+				if (r->exited) {
+					list_remove (&r->elem);
+					free (r);
+				} else
+					r->detached = true;
+				result = 0;
+			}
+			break;
+		}
+	}
+	lock_release (&p->lock);
+	return result;
+}
+
+/* Exits the running thread with STATUS for a thread that joins
+   it, leaving the rest of its process running.  If it is the
+   last thread of the process, the process exits too. */
+void
+process_thread_exit (int status) {
+	if (thread_current ()->process != NULL)
+		process_leave (status);
+	thread_exit ();
+}
+
+/* Returns true if the running thread belongs to a process that is
+   exiting, in which case the thread should exit rather than go
+   back to user mode. */
+bool
+process_exiting (void) {
+	struct process *p = thread_current ()->process;
+
+	return p != NULL && p->exiting;
+}
+
+/* Marks P as exiting and wakes up its threads sleeping on futexes,
+   so that each of them exits the next time it would return to
+   user mode. */
+static void
+process_kill (struct process *p) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	lock_acquire (&p->lock);
+	old_level = intr_disable ();
+	p->exiting = true;
+	for (e = list_begin (&p->threads); e != list_end (&p->threads);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, proc_elem);
+
+		if (t != curr)
+			futex_cancel (t);
+	}
+	intr_set_level (old_level);
+	lock_release (&p->lock);
+}
+
+/* Removes the running thread from its process, recording STATUS
+   for a thread that joins it, or freeing its exit record if it is
+   detached, and freeing its user stack.  If it
+   was the last thread, frees the process but leaves the address
+   space for process_cleanup() to destroy; otherwise the thread
+   switches to the kernel-only page map. */
+static void
+process_leave (int status) {
+	struct thread *curr = thread_current ();
+	struct process *p = curr->process;
+	bool last;
+
+	lock_acquire (&p->lock);
+	if (curr->exit_rec->detached) {
+		list_remove (&curr->exit_rec->elem);
+		free (curr->exit_rec);
+	} else {
+		curr->exit_rec->status = status;
+		curr->exit_rec->exited = true;
+		sema_up (&curr->exit_rec->dead);
+	}
+	list_remove (&curr->proc_elem);
+	p->stack_slots &= ~(1u << curr->stack_slot);
+	last = --p->thread_cnt == 0;
+	if (!last) {
+		void *upage = stack_page (curr->stack_slot);
+		void *kpage = pml4_get_page (p->pml4, upage);
+
+		if (kpage != NULL) {
+			pml4_clear_page (p->pml4, upage);
+			palloc_free_page (kpage);
+		}
+	}
+	lock_release (&p->lock);
+
+	curr->process = NULL;
+	curr->exit_rec = NULL;
+	if (!last) {
+		/* Same ordering as in process_cleanup(). */
+		curr->pml4 = NULL;
+		pml4_activate (NULL);
+	} else {
+		while (!list_empty (&p->exits))
+			free (list_entry (list_pop_front (&p->exits),
+						struct exit_record, elem));
+		free (p);
+	}
+}
+
 /* Sets up the CPU for running user code in the nest thread.
  * This function is called on every context switch. */
 void
@@ -331,7 +706,7 @@ load (const char *file_name, struct intr_frame *if_) {
 
 	/* Allocate and activate page directory. */
 	t->pml4 = pml4_create ();
-	if (t->pml4 == NULL)
+	if (t->pml4 == NULL || !process_start (t))
 		goto done;
 	process_activate (thread_current ());
 
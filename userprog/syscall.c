@@ -1,16 +1,26 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
 #include <syscall-nr.h>
+#include "threads/futex.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
+#include "vm/vm.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 
+static int sys_futex (uint32_t *uaddr, int op, uint32_t val,
+		uint32_t *uaddr2, int val2);
+static bool futex_uaddr_valid (const uint32_t *uaddr);
+static bool futex_fault_in (const uint32_t *uaddr);
+
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -23,6 +33,7 @@ void syscall_handler (struct intr_frame *);
 #define MSR_STAR 0xc0000081         /* Segment selector msr */
 #define MSR_LSTAR 0xc0000082        /* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
+#define MSR_KERNEL_GS_BASE 0xc0000102 /* %gs base after swapgs */
 
 void
 syscall_init (void) {
@@ -35,12 +46,128 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	/* syscall_entry finds the running CPU's TSS, and room to save
+	 * registers, through %gs after a swapgs.  Each CPU calls this
+	 * to point it at its own struct cpu. */
+	write_msr(MSR_KERNEL_GS_BASE, (uint64_t) cpu_current ());
 }
 
 /* The main system call interface */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
-	// TODO: Your implementation goes here.
-	printf ("system call!\n");
-	thread_exit ();
+syscall_handler (struct intr_frame *f) {
+	switch (f->R.rax) {
+	case SYS_CPU_QUOTA:
+		/* Limits this process, and the processes it starts from
+		   now on, to QUOTA ticks of CPU in every PERIOD ticks.  A
+		   negative QUOTA removes the limit. */
+		f->R.rax = thread_set_cpu_quota ((int) f->R.rdi, (int) f->R.rsi);
+		break;
+
+	case SYS_FUTEX:
+		/* Arguments are UADDR, OP, VAL, UADDR2 and VAL2. */
+		f->R.rax = sys_futex ((uint32_t *) f->R.rdi, (int) f->R.rsi,
+				(uint32_t) f->R.rdx, (uint32_t *) f->R.r10, (int) f->R.r8);
+		break;
+
+	case SYS_THREAD_CREATE:
+		/* Arguments are ENTRY and the two arguments to pass it. */
+		f->R.rax = process_thread_create (f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+
+	case SYS_THREAD_JOIN:
+		f->R.rax = process_thread_join ((tid_t) f->R.rdi);
+		break;
+
+	case SYS_THREAD_DETACH:
+		f->R.rax = process_thread_detach ((tid_t) f->R.rdi);
+		break;
+
+	case SYS_THREAD_EXIT:
+		process_thread_exit ((int) f->R.rdi);
+		NOT_REACHED ();
+
+	default:
+		// TODO: Your implementation goes here.
+		printf ("system call!\n");
+		thread_exit ();
+	}
+
+	/* Another thread may have exited the whole process while this
+	   one was in the kernel. */
+	if (process_exiting ())
+		thread_exit ();
+}
+
+/* Carries out futex operation OP on the user word at UADDR, and
+   on UADDR2 for FUTEX_REQUEUE.  The futex is keyed by the kernel
+   address of the word, that is, by the frame it lives in.  The
+   words are translated and the operation done with interrupts
+   off, so the frames cannot be evicted in between.  A page that
+   is not in memory, such as one not yet loaded lazily, is faulted
+   in first rather than reported as a changed word, which user
+   code would retry forever. */
+static int
+sys_futex (uint32_t *uaddr, int op, uint32_t val,
+		uint32_t *uaddr2, int val2) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	uint32_t *word, *word2 = NULL;
+	enum intr_level old_level;
+	int result;
+
+	if (op != FUTEX_WAIT && op != FUTEX_WAKE && op != FUTEX_REQUEUE)
+		return FUTEX_EINVAL;
+	if (!futex_uaddr_valid (uaddr)
+			|| (op == FUTEX_REQUEUE && !futex_uaddr_valid (uaddr2)))
+		return FUTEX_EINVAL;
+
+	for (;;) {
+		old_level = intr_disable ();
+		word = pml4_get_page (pml4, uaddr);
+		if (op == FUTEX_REQUEUE)
+			word2 = pml4_get_page (pml4, uaddr2);
+		if (word != NULL && (op != FUTEX_REQUEUE || word2 != NULL))
+			break;
+		intr_set_level (old_level);
+
+		if ((word == NULL && !futex_fault_in (uaddr))
+				|| (op == FUTEX_REQUEUE && word2 == NULL
+					&& !futex_fault_in (uaddr2)))
+			return FUTEX_EINVAL;
+	}
+
+	switch (op) {
+	case FUTEX_WAIT:
+		result = futex_wait (word, val) == 0 ? 0 : FUTEX_EAGAIN;
+		break;
+	case FUTEX_WAKE:
+		result = futex_wake (word, (int) val);
+		break;
+	default:
+		result = futex_requeue (word, (int) val, word2, val2);
+		break;
+	}
+	intr_set_level (old_level);
+	return result;
+}
+
+/* Returns true if UADDR may be a futex word of the running
+   process: a non-null, aligned user address. */
+static bool
+futex_uaddr_valid (const uint32_t *uaddr) {
+	return uaddr != NULL && (uintptr_t) uaddr % sizeof *uaddr == 0
+		&& is_user_vaddr (uaddr);
+}
+
+/* Brings the page holding UADDR into memory.  Returns false if
+   UADDR is not part of the running process's address space. */
+static bool
+futex_fault_in (const uint32_t *uaddr) {
+#ifdef VM
+	return vm_claim_page (pg_round_down (uaddr));
+#else
+	/* Without VM, every page of the process is loaded up front. */
+	(void) uaddr;
+	return false;
+#endif
 }